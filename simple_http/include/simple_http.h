@@ -4,11 +4,15 @@
 
 #pragma once
 
+#include "../lib/content_coding.h"
 #include "../lib/http_headers.h"
 #include "../lib/http_method.h"
 #include "../lib/http_server.h"
 #include "../lib/http_version.h"
 #include "../lib/incoming_message.h"
 #include "../lib/init_library.h"
+#include "../lib/open_file_cache.h"
 #include "../lib/outgoing_message.h"
+#include "../lib/static_cache.h"
+#include "../lib/static_index.h"
 #include "../lib/utils.h"
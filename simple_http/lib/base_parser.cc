@@ -4,9 +4,10 @@
 
 #include "base_parser.h"
 
-#include <cctype>
 #include <string_view>
 
+#include "char_classes.h"
+
 namespace simple_http {
 
 bool BaseParser::parseSymbol(char symbol, const std::string_view& line,
@@ -20,7 +21,7 @@ bool BaseParser::parseLiteral(const std::string_view& literal,
     size_t start = state.index;
     size_t index = state.index;
     while (index < line.length() && index - start < literal.length() &&
-           ::tolower(literal[index - start]) == ::tolower(line[index])) {
+           ToLowerAscii(literal[index - start]) == ToLowerAscii(line[index])) {
         index++;
     }
 
@@ -0,0 +1,142 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "byte_scanner.h"
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#define SIMPLE_HTTP_HAS_SSE2 1
+
+#include <emmintrin.h>
+
+#if defined(__GNUC__)
+
+#define SIMPLE_HTTP_HAS_AVX2 1
+
+#include <immintrin.h>
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+
+#endif
+
+#endif
+
+namespace simple_http {
+
+static size_t FindFirstOfScalar(const char* buffer, size_t length, char first,
+                                char second) {
+    for (size_t i = 0; i < length; i++) {
+        if (buffer[i] == first || buffer[i] == second) {
+            return i;
+        }
+    }
+
+    return length;
+}
+
+#ifdef SIMPLE_HTTP_HAS_SSE2
+
+static unsigned CountTrailingZeros(unsigned mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#endif
+}
+
+static size_t FindFirstOfSse2(const char* buffer, size_t length, char first,
+                              char second) {
+    const __m128i first_pattern = _mm_set1_epi8(first);
+    const __m128i second_pattern = _mm_set1_epi8(second);
+
+    size_t index = 0;
+    for (; index + 16 <= length; index += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + index));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, first_pattern),
+                                       _mm_cmpeq_epi8(chunk, second_pattern));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches));
+        if (mask != 0) {
+            return index + CountTrailingZeros(mask);
+        }
+    }
+
+    return index + FindFirstOfScalar(buffer + index, length - index, first,
+                                     second);
+}
+
+#endif
+
+#ifdef SIMPLE_HTTP_HAS_AVX2
+
+__attribute__((target("avx2"))) static size_t FindFirstOfAvx2(
+    const char* buffer, size_t length, char first, char second) {
+    const __m256i first_pattern = _mm256_set1_epi8(first);
+    const __m256i second_pattern = _mm256_set1_epi8(second);
+
+    size_t index = 0;
+    for (; index + 32 <= length; index += 32) {
+        __m256i chunk = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(buffer + index));
+        __m256i matches =
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, first_pattern),
+                            _mm256_cmpeq_epi8(chunk, second_pattern));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+        if (mask != 0) {
+            return index + CountTrailingZeros(mask);
+        }
+    }
+
+    return index +
+           FindFirstOfSse2(buffer + index, length - index, first, second);
+}
+
+#endif
+
+typedef size_t FindFirstOfFunction(const char* buffer, size_t length,
+                                   char first, char second);
+
+static FindFirstOfFunction* SelectFindFirstOf() {
+#if defined(SIMPLE_HTTP_HAS_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return FindFirstOfAvx2;
+    }
+#endif
+
+#if defined(SIMPLE_HTTP_HAS_SSE2)
+    return FindFirstOfSse2;
+#else
+    return FindFirstOfScalar;
+#endif
+}
+
+size_t FindFirstOf(const char* buffer, size_t length, char first,
+                   char second) {
+    static FindFirstOfFunction* const find_first_of = SelectFindFirstOf();
+    return find_first_of(buffer, length, first, second);
+}
+
+size_t FindCRLF(const char* buffer, size_t length) {
+    size_t index = 0;
+    while (true) {
+        index += FindByte(buffer + index, length - index, '\r');
+        if (index + 1 >= length) {
+            return kNotFound;
+        }
+
+        if (buffer[index + 1] == '\n') {
+            return index;
+        }
+
+        index++;
+    }
+}
+
+}  // namespace simple_http
@@ -0,0 +1,29 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+
+namespace simple_http {
+
+// Searches for delimiters 16 or 32 bytes at a time (SSE2 or AVX2, chosen
+// at runtime), bytewise on other processors.
+
+// Returns the index of the first byte equal to first or second, or length
+// when there is none.
+size_t FindFirstOf(const char* buffer, size_t length, char first,
+                   char second);
+
+inline size_t FindByte(const char* buffer, size_t length, char byte) {
+    return FindFirstOf(buffer, length, byte, byte);
+}
+
+// Returned by FindCRLF() when there is no match.
+inline constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+// Returns the index of the first "\r\n", or kNotFound when there is none.
+size_t FindCRLF(const char* buffer, size_t length);
+
+}  // namespace simple_http
@@ -0,0 +1,118 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace simple_http {
+
+// Character classes of RFC 2616 and RFC 3986, one bit per class.
+enum CharClass : uint8_t {
+    kDigit = 1 << 0,
+    kAlpha = 1 << 1,
+    kHex = 1 << 2,
+    // Any CHAR except CTLs or tspecials.
+    kTokenChar = 1 << 3,
+    kUnreserved = 1 << 4,
+    kSubDelims = 1 << 5,
+    // pchar without pct-encoded.
+    kPathChar = 1 << 6,
+    // Path characters, '/' and '?'.
+    kQueryChar = 1 << 7,
+};
+
+using CharClassTable = std::array<uint8_t, 256>;
+
+constexpr CharClassTable MakeCharClassTable() {
+    CharClassTable table{};
+
+    auto add = [&table](std::string_view symbols, uint8_t char_class) {
+        for (char symbol : symbols) {
+            table[static_cast<unsigned char>(symbol)] |= char_class;
+        }
+    };
+
+    for (int symbol = '0'; symbol <= '9'; symbol++) {
+        table[symbol] |= kDigit | kHex;
+    }
+
+    for (int symbol = 'a'; symbol <= 'z'; symbol++) {
+        table[symbol] |= kAlpha;
+        table[symbol - 'a' + 'A'] |= kAlpha;
+    }
+
+    add("abcdefABCDEF", kHex);
+
+    for (int symbol = 33; symbol < 127; symbol++) {
+        table[symbol] |= kTokenChar;
+    }
+    for (char symbol : std::string_view("()<>@,;:\\\"/[]?={}")) {
+        table[static_cast<unsigned char>(symbol)] &= ~kTokenChar;
+    }
+
+    for (int symbol = 0; symbol < 256; symbol++) {
+        if (table[symbol] & (kDigit | kAlpha)) {
+            table[symbol] |= kUnreserved;
+        }
+    }
+    add("-._~", kUnreserved);
+
+    add("!$&'()*+,;=", kSubDelims);
+
+    for (int symbol = 0; symbol < 256; symbol++) {
+        if (table[symbol] & (kUnreserved | kSubDelims)) {
+            table[symbol] |= kPathChar;
+        }
+    }
+    add(":@", kPathChar);
+
+    for (int symbol = 0; symbol < 256; symbol++) {
+        if (table[symbol] & kPathChar) {
+            table[symbol] |= kQueryChar;
+        }
+    }
+    add("/?", kQueryChar);
+
+    return table;
+}
+
+inline constexpr CharClassTable kCharClasses = MakeCharClassTable();
+
+constexpr bool IsCharClass(char symbol, uint8_t char_class) {
+    return (kCharClasses[static_cast<unsigned char>(symbol)] & char_class) != 0;
+}
+
+// The symbol must be of kHex.
+constexpr uint8_t GetHexValue(char symbol) {
+    if (symbol >= '0' && symbol <= '9') {
+        return symbol - '0';
+    }
+
+    return (symbol | 0x20) - 'a' + 10;
+}
+
+// Locale independent, unlike ::tolower.
+constexpr char ToLowerAscii(char symbol) {
+    return symbol >= 'A' && symbol <= 'Z' ? symbol - 'A' + 'a' : symbol;
+}
+
+constexpr bool IsEqualsCaseInsensitive(std::string_view first,
+                                       std::string_view second) {
+    if (first.length() != second.length()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < first.length(); i++) {
+        if (ToLowerAscii(first[i]) != ToLowerAscii(second[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace simple_http
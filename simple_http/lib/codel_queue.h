@@ -0,0 +1,152 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace simple_http {
+
+struct CoDelOptions {
+    // Waiting time the queue may keep when it never drains.
+    std::chrono::milliseconds target = std::chrono::milliseconds(5);
+    // How long the waiting time must stay above the target before the
+    // queue counts as standing.
+    std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+    // Values waiting longer are expired.
+    std::chrono::milliseconds budget = std::chrono::milliseconds(1000);
+};
+
+// Bounded queue controlling how long values wait in it (CoDel). While the
+// queue keeps draining it is FIFO. When even the shortest wait over an
+// interval exceeds the target, the queue is standing: the newest values are
+// taken first (adaptive LIFO), so fresh requests are served while old ones,
+// whose clients have likely given up, expire after twice the target. Values
+// expire after the budget in any case.
+template <typename T>
+class CoDelQueue {
+   public:
+    typedef std::chrono::steady_clock Clock;
+
+    CoDelQueue(size_t capacity, const CoDelOptions& options)
+        : entries_(new Entry[capacity]),
+          capacity_(capacity),
+          options_(options) {
+        assert(capacity > 0);
+        assert(options.budget.count() > 0);
+    };
+
+    CoDelQueue(const CoDelQueue&) = delete;
+    CoDelQueue& operator=(const CoDelQueue&) = delete;
+
+    // Returns false when the queue is full, the value is left untouched.
+    bool tryPush(T& value) {
+        Clock::time_point now = Clock::now();
+        std::unique_lock lock(mutex_);
+        if (count_ == capacity_) {
+            return false;
+        }
+
+        Entry& entry = entries_[(start_ + count_) % capacity_];
+        entry.value = std::move(value);
+        entry.enqueued = now;
+        count_++;
+        size_.store(count_, std::memory_order_relaxed);
+        return true;
+    };
+
+    // Returns false when the queue is empty. An expired value is returned
+    // too, so that its owner releases it.
+    bool tryPop(T& value, bool& is_expired) {
+        if (size_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        Clock::time_point now = Clock::now();
+        std::unique_lock lock(mutex_);
+        if (count_ == 0) {
+            return false;
+        }
+
+        Entry& oldest = entries_[start_];
+        Clock::duration sojourn = now - oldest.enqueued;
+        updateState(sojourn, now);
+
+        Clock::duration limit = options_.budget;
+        if (is_standing_) {
+            limit = std::min(limit, Clock::duration(2 * options_.target));
+        }
+
+        if (sojourn > limit) {
+            is_expired = true;
+            takeOldest(value);
+        } else if (is_standing_) {
+            is_expired = false;
+            takeNewest(value);
+        } else {
+            is_expired = false;
+            takeOldest(value);
+        }
+
+        if (count_ == 0) {
+            // The queue has drained, so it is not standing.
+            min_sojourn_ = Clock::duration::zero();
+        }
+        size_.store(count_, std::memory_order_relaxed);
+        return true;
+    };
+
+    // Approximate, it does not synchronize with the other threads.
+    size_t getSize() const { return size_.load(std::memory_order_relaxed); };
+
+   private:
+    struct Entry {
+        T value;
+        Clock::time_point enqueued;
+    };
+
+    // Tracks the shortest wait within the interval; the queue is standing
+    // for the next interval when it stayed above the target.
+    void updateState(Clock::duration sojourn, Clock::time_point now) {
+        if (now >= interval_end_) {
+            is_standing_ = min_sojourn_ > options_.target;
+            min_sojourn_ = sojourn;
+            interval_end_ = now + options_.interval;
+        } else {
+            min_sojourn_ = std::min(min_sojourn_, sojourn);
+        }
+    };
+
+    void takeOldest(T& value) {
+        value = std::move(entries_[start_].value);
+        start_ = (start_ + 1) % capacity_;
+        count_--;
+    };
+
+    void takeNewest(T& value) {
+        count_--;
+        value = std::move(entries_[(start_ + count_) % capacity_].value);
+    };
+
+    std::mutex mutex_;
+    std::unique_ptr<Entry[]> entries_;
+    size_t capacity_;
+    size_t start_ = 0;
+    size_t count_ = 0;
+    std::atomic<size_t> size_ = 0;
+
+    CoDelOptions options_;
+    Clock::duration min_sojourn_ = Clock::duration::zero();
+    Clock::time_point interval_end_;
+    bool is_standing_ = false;
+};
+
+}  // namespace simple_http
@@ -0,0 +1,138 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "content_coding.h"
+
+#include <optional>
+#include <string_view>
+
+#include "char_classes.h"
+
+namespace simple_http {
+
+static std::string_view TrimWhitespace(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+
+    return value;
+}
+
+static std::optional<ContentCoding> GetContentCoding(std::string_view name) {
+    if (IsEqualsCaseInsensitive(name, "gzip") ||
+        IsEqualsCaseInsensitive(name, "x-gzip")) {
+        return ContentCoding::kGzip;
+    }
+
+    if (IsEqualsCaseInsensitive(name, "br")) {
+        return ContentCoding::kBrotli;
+    }
+
+    if (IsEqualsCaseInsensitive(name, "zstd")) {
+        return ContentCoding::kZstd;
+    }
+
+    if (IsEqualsCaseInsensitive(name, "identity")) {
+        return ContentCoding::kIdentity;
+    }
+
+    return std::nullopt;
+}
+
+// Whether the parameters of an element, e.g. "q=0.5", give a zero qvalue.
+static bool IsZeroQuality(std::string_view parameters) {
+    while (!parameters.empty()) {
+        size_t end = parameters.find(';');
+        std::string_view parameter = TrimWhitespace(parameters.substr(0, end));
+        parameters.remove_prefix(end == std::string_view::npos
+                                     ? parameters.length()
+                                     : end + 1);
+        if (parameter.length() < 2 || ToLowerAscii(parameter[0]) != 'q' ||
+            parameter[1] != '=') {
+            continue;
+        }
+
+        // A qvalue is zero when all of its digits are.
+        for (char symbol : parameter.substr(2)) {
+            if (symbol != '0' && symbol != '.') {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+ContentCodings ParseAcceptEncoding(std::string_view value) {
+    ContentCodings accepted = 0;
+    ContentCodings listed = 0;
+    std::optional<bool> is_any_accepted;
+    while (!value.empty()) {
+        size_t end = value.find(',');
+        std::string_view element = value.substr(0, end);
+        value.remove_prefix(end == std::string_view::npos ? value.length()
+                                                          : end + 1);
+
+        size_t parameters_start = element.find(';');
+        std::string_view name =
+            TrimWhitespace(element.substr(0, parameters_start));
+        bool is_accepted =
+            parameters_start == std::string_view::npos ||
+            !IsZeroQuality(element.substr(parameters_start + 1));
+        if (name == "*") {
+            is_any_accepted = is_accepted;
+            continue;
+        }
+
+        std::optional<ContentCoding> coding = GetContentCoding(name);
+        if (!coding) {
+            continue;
+        }
+
+        listed |= ToContentCodings(*coding);
+        if (is_accepted) {
+            accepted |= ToContentCodings(*coding);
+        }
+    }
+
+    if (is_any_accepted.value_or(false)) {
+        accepted |= ~listed & ((1 << kContentCodingsCount) - 1);
+    }
+
+    return accepted | ToContentCodings(ContentCoding::kIdentity);
+}
+
+std::string_view GetContentCodingName(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::kGzip:
+            return "gzip";
+        case ContentCoding::kBrotli:
+            return "br";
+        case ContentCoding::kZstd:
+            return "zstd";
+        default:
+            return "identity";
+    }
+}
+
+std::string_view GetContentCodingExtension(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::kGzip:
+            return ".gz";
+        case ContentCoding::kBrotli:
+            return ".br";
+        case ContentCoding::kZstd:
+            return ".zst";
+        default:
+            return "";
+    }
+}
+
+}  // namespace simple_http
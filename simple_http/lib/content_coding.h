@@ -0,0 +1,36 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace simple_http {
+
+// Codings of precompressed files, see StaticIndex.
+enum class ContentCoding : uint8_t { kIdentity = 0, kGzip, kBrotli, kZstd };
+
+inline constexpr size_t kContentCodingsCount = 4;
+
+// A set of codings, one bit per coding.
+typedef uint8_t ContentCodings;
+
+constexpr ContentCodings ToContentCodings(ContentCoding coding) {
+    return static_cast<ContentCodings>(1 << static_cast<uint8_t>(coding));
+}
+
+// Returns the codings acceptable by an Accept-Encoding value, those with
+// a zero qvalue excluded. The identity coding is always acceptable.
+ContentCodings ParseAcceptEncoding(std::string_view value);
+
+// Returns the name used in Content-Encoding, e.g. "br".
+std::string_view GetContentCodingName(ContentCoding coding);
+
+// Returns the extension of a file compressed with the coding, e.g. ".br",
+// and an empty string for the identity coding.
+std::string_view GetContentCodingExtension(ContentCoding coding);
+
+}  // namespace simple_http
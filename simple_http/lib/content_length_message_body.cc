@@ -5,6 +5,7 @@
 #include "content_length_message_body.h"
 
 #include <algorithm>
+#include <chrono>
 
 #include "message_body.h"
 
@@ -16,15 +17,16 @@ size_t ContentLengthMessageBody::read(char *buffer, size_t length,
                                       MessageBody::ReadError &error) {
     size_t offset = 0;
     while (length != 0 && remaining_bytes_ != 0) {
+        updateDeadline();
         SocketReader::ReadError read_error;
         SocketReader::ReadResult result = input_.read(read_error);
-        if (read_error != SocketReader::ReadError::kOk) {
-            error = ReadError::kConnectionClosed;
+        if (read_error == SocketReader::ReadError::kTimedOut) {
+            error = ReadError::kTimedOut;
             return -1;
         }
 
-        if (result.getLength() > remaining_bytes_) {
-            error = ReadError::kBadSyntax;
+        if (read_error != SocketReader::ReadError::kOk) {
+            error = ReadError::kConnectionClosed;
             return -1;
         }
 
@@ -37,7 +39,9 @@ size_t ContentLengthMessageBody::read(char *buffer, size_t length,
             break;
         }
 
-        size_t consumed_bytes = std::min(result.getLength(), length);
+        // Bytes past the body belong to the next request on the connection.
+        size_t consumed_bytes =
+            std::min({result.getLength(), length, remaining_bytes_});
         const char *start = result.getBuffer();
         const char *end = result.getBuffer() + consumed_bytes;
         char *destination = buffer + offset;
@@ -55,25 +59,40 @@ size_t ContentLengthMessageBody::read(char *buffer, size_t length,
 
 MessageBody::ReadError ContentLengthMessageBody::consume() {
     while (remaining_bytes_ != 0) {
+        updateDeadline();
         SocketReader::ReadError read_error;
         SocketReader::ReadResult result = input_.read(read_error);
-        if (read_error != SocketReader::ReadError::kOk) {
-            return ReadError::kConnectionClosed;
+        if (read_error == SocketReader::ReadError::kTimedOut) {
+            return ReadError::kTimedOut;
         }
 
-        if (result.getLength() > remaining_bytes_) {
-            return ReadError::kBadSyntax;
+        if (read_error != SocketReader::ReadError::kOk) {
+            return ReadError::kConnectionClosed;
         }
 
         if (result.isCompleted() && result.getLength() < remaining_bytes_) {
             return ReadError::kBadSyntax;
         }
 
-        remaining_bytes_ -= result.getLength();
-        input_.advance(result.getLength());
+        size_t consumed_bytes = std::min(result.getLength(), remaining_bytes_);
+        remaining_bytes_ -= consumed_bytes;
+        input_.advance(consumed_bytes);
     };
 
     return ReadError::kOk;
 }
 
+void ContentLengthMessageBody::updateDeadline() {
+    if (min_rate_ == 0) {
+        return;
+    }
+
+    std::chrono::duration<double> transfer_time(
+        static_cast<double>(length_ - remaining_bytes_) / min_rate_);
+    input_.setDeadline(
+        start_ + grace_ +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            transfer_time));
+}
+
 }  // namespace simple_http
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+
 #include "message_body.h"
 #include "socket_reader.h"
 
@@ -13,8 +16,18 @@ class ContentLengthMessageBody : public MessageBody {
    public:
     ContentLengthMessageBody() = delete;
 
-    ContentLengthMessageBody(SocketReader& input, size_t length)
-        : input_(input), remaining_bytes_(length) {}
+    // With a non-zero min_rate (bytes per second) the body must arrive
+    // within the grace period plus the time its transferred part takes at
+    // that rate, so a client trickling bytes cannot hold the connection.
+    ContentLengthMessageBody(SocketReader& input, size_t length,
+                             size_t min_rate = 0,
+                             std::chrono::milliseconds grace = {})
+        : input_(input),
+          length_(length),
+          remaining_bytes_(length),
+          min_rate_(min_rate),
+          grace_(grace),
+          start_(std::chrono::steady_clock::now()) {}
 
     size_t read(char* buffer, size_t length,
                 MessageBody::ReadError& error) override;
@@ -22,8 +35,16 @@ class ContentLengthMessageBody : public MessageBody {
     MessageBody::ReadError consume() override;
 
    private:
+    // Sets the deadline of the input for the bytes transferred so far.
+    void updateDeadline();
+
     SocketReader& input_;
+    size_t length_;
     size_t remaining_bytes_;
+
+    size_t min_rate_;
+    std::chrono::milliseconds grace_;
+    std::chrono::steady_clock::time_point start_;
 };
 
 }  // namespace simple_http
@@ -0,0 +1,223 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "epoll_event_loop.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+
+#include "event_loop.h"
+#include "socket_descriptor.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#endif
+
+#undef min
+
+namespace simple_http {
+
+#ifdef __linux__
+
+constexpr int kInvalidDescriptor = -1;
+
+constexpr size_t kMaxEventsPerWait = 256;
+
+constexpr uint32_t kWatchedEvents =
+    EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+
+static EventLoop::WatchError Control(int poll_descriptor, int operation,
+                                     SocketDescriptor descriptor,
+                                     uint32_t events, void* data) {
+    ::epoll_event event;
+    event.events = events;
+    event.data.ptr = data;
+    if (::epoll_ctl(poll_descriptor, operation, descriptor, &event) ==
+        kInvalidDescriptor) {
+        return EventLoop::WatchError::kUnknown;
+    }
+
+    return EventLoop::WatchError::kOk;
+}
+
+std::unique_ptr<EventLoop> EpollEventLoop::create(
+    EventLoop::CreateError& error) {
+    int poll_descriptor = ::epoll_create1(EPOLL_CLOEXEC);
+    if (poll_descriptor == kInvalidDescriptor) {
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+
+    int wake_descriptor = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_descriptor == kInvalidDescriptor) {
+        ::close(poll_descriptor);
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+
+    if (Control(poll_descriptor, EPOLL_CTL_ADD, wake_descriptor, EPOLLIN,
+                nullptr) != EventLoop::WatchError::kOk) {
+        ::close(wake_descriptor);
+        ::close(poll_descriptor);
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+
+    error = EventLoop::CreateError::kOk;
+    return std::unique_ptr<EventLoop>(
+        new EpollEventLoop(poll_descriptor, wake_descriptor));
+}
+
+bool EpollEventLoop::isSupported() { return true; }
+
+EpollEventLoop::EpollEventLoop(int poll_descriptor, int wake_descriptor)
+    : poll_descriptor_(poll_descriptor), wake_descriptor_(wake_descriptor) {}
+
+EpollEventLoop::~EpollEventLoop() {
+    ::close(wake_descriptor_);
+    ::close(poll_descriptor_);
+}
+
+EventLoop::WatchError EpollEventLoop::addListener(SocketDescriptor descriptor,
+                                                  void* data) {
+    assert(data != nullptr);
+
+    listener_data_ = data;
+    return Control(poll_descriptor_, EPOLL_CTL_ADD, descriptor,
+                   EPOLLIN | EPOLLET | EPOLLONESHOT, data);
+}
+
+EventLoop::WatchError EpollEventLoop::rearmListener(
+    SocketDescriptor descriptor, void* data) {
+    assert(data != nullptr);
+
+    return Control(poll_descriptor_, EPOLL_CTL_MOD, descriptor,
+                   EPOLLIN | EPOLLET | EPOLLONESHOT, data);
+}
+
+EventLoop::WatchError EpollEventLoop::add(SocketDescriptor descriptor,
+                                          void* data) {
+    assert(data != nullptr);
+
+    return Control(poll_descriptor_, EPOLL_CTL_ADD, descriptor,
+                   kWatchedEvents, data);
+}
+
+EventLoop::WatchError EpollEventLoop::rearm(SocketDescriptor descriptor,
+                                            void* data) {
+    assert(data != nullptr);
+
+    return Control(poll_descriptor_, EPOLL_CTL_MOD, descriptor,
+                   kWatchedEvents, data);
+}
+
+void EpollEventLoop::remove(SocketDescriptor, void*) {
+    // Closing the descriptor removes it from the epoll set.
+}
+
+void EpollEventLoop::releaseBuffer(const EventLoop::Event&) {}
+
+size_t EpollEventLoop::wait(EventLoop::Event* events, size_t events_capacity,
+                            std::chrono::milliseconds timeout,
+                            EventLoop::WaitError& error) {
+    assert(events_capacity > 0);
+
+    ::epoll_event native_events[kMaxEventsPerWait];
+    int native_timeout = timeout.count() < 0
+                             ? -1
+                             : static_cast<int>(timeout.count());
+    int events_count = ::epoll_wait(
+        poll_descriptor_, native_events,
+        static_cast<int>(std::min(events_capacity, kMaxEventsPerWait)),
+        native_timeout);
+    if (events_count == kInvalidDescriptor) {
+        error = errno == EINTR ? EventLoop::WaitError::kInterrupt
+                               : EventLoop::WaitError::kUnknown;
+        return 0;
+    }
+
+    size_t ready_count = 0;
+    for (int i = 0; i < events_count; i++) {
+        void* data = native_events[i].data.ptr;
+        if (data == nullptr) {
+            uint64_t value;
+            ::read(wake_descriptor_, &value, sizeof(value));
+            continue;
+        }
+
+        EventLoop::Event& event = events[ready_count++];
+        event = EventLoop::Event();
+        event.type = data == listener_data_
+                         ? EventLoop::Event::Type::kAcceptable
+                         : EventLoop::Event::Type::kReadable;
+        event.data = data;
+    }
+
+    error = EventLoop::WaitError::kOk;
+    return ready_count;
+}
+
+void EpollEventLoop::wake() {
+    uint64_t value = 1;
+    ::write(wake_descriptor_, &value, sizeof(value));
+}
+
+#else
+
+std::unique_ptr<EventLoop> EpollEventLoop::create(
+    EventLoop::CreateError& error) {
+    error = EventLoop::CreateError::kNotSupported;
+    return nullptr;
+}
+
+bool EpollEventLoop::isSupported() { return false; }
+
+EpollEventLoop::EpollEventLoop(int poll_descriptor, int wake_descriptor)
+    : poll_descriptor_(poll_descriptor), wake_descriptor_(wake_descriptor) {}
+
+EpollEventLoop::~EpollEventLoop() {}
+
+EventLoop::WatchError EpollEventLoop::addListener(SocketDescriptor descriptor,
+                                                  void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError EpollEventLoop::rearmListener(
+    SocketDescriptor descriptor, void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError EpollEventLoop::add(SocketDescriptor descriptor,
+                                          void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError EpollEventLoop::rearm(SocketDescriptor descriptor,
+                                            void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+void EpollEventLoop::remove(SocketDescriptor, void*) {}
+
+void EpollEventLoop::releaseBuffer(const EventLoop::Event&) {}
+
+size_t EpollEventLoop::wait(EventLoop::Event* events, size_t events_capacity,
+                            std::chrono::milliseconds timeout,
+                            EventLoop::WaitError& error) {
+    error = EventLoop::WaitError::kUnknown;
+    return 0;
+}
+
+void EpollEventLoop::wake() {}
+
+#endif
+
+}  // namespace simple_http
@@ -0,0 +1,51 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "event_loop.h"
+#include "socket_descriptor.h"
+
+namespace simple_http {
+
+// Readiness notifications from epoll. Connections are reported as
+// kReadable, the listening socket as kAcceptable.
+class EpollEventLoop : public EventLoop {
+   public:
+    static std::unique_ptr<EventLoop> create(CreateError& error);
+
+    static bool isSupported();
+
+    ~EpollEventLoop() override;
+
+    WatchError addListener(SocketDescriptor descriptor, void* data) override;
+
+    WatchError rearmListener(SocketDescriptor descriptor,
+                             void* data) override;
+
+    WatchError add(SocketDescriptor descriptor, void* data) override;
+
+    WatchError rearm(SocketDescriptor descriptor, void* data) override;
+
+    void remove(SocketDescriptor descriptor, void* data) override;
+
+    void releaseBuffer(const Event& event) override;
+
+    size_t wait(Event* events, size_t events_capacity,
+                std::chrono::milliseconds timeout, WaitError& error) override;
+
+    void wake() override;
+
+   private:
+    EpollEventLoop(int poll_descriptor, int wake_descriptor);
+
+    int poll_descriptor_;
+    int wake_descriptor_;
+    void* listener_data_ = nullptr;
+};
+
+}  // namespace simple_http
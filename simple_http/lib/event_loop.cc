@@ -0,0 +1,33 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "event_loop.h"
+
+#include <memory>
+
+#include "epoll_event_loop.h"
+#include "io_uring_event_loop.h"
+
+namespace simple_http {
+
+std::unique_ptr<EventLoop> EventLoop::create(EventLoop::Backend backend,
+                                             EventLoop::CreateError& error) {
+    switch (backend) {
+        case Backend::kIoUring:
+            return IoUringEventLoop::create(error);
+        default:
+            return EpollEventLoop::create(error);
+    }
+}
+
+bool EventLoop::isSupported(EventLoop::Backend backend) {
+    switch (backend) {
+        case Backend::kIoUring:
+            return IoUringEventLoop::isSupported();
+        default:
+            return EpollEventLoop::isSupported();
+    }
+}
+
+}  // namespace simple_http
@@ -0,0 +1,107 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "socket_descriptor.h"
+
+namespace simple_http {
+
+// Notifications about non-blocking sockets. Every watched connection is
+// reported once per add() or rearm(), so only one thread at a time
+// processes it. All methods except wake() must be called from the thread
+// running wait().
+class EventLoop {
+   public:
+    enum class Backend {
+        // Readiness notifications from epoll, the data is read by recv().
+        kEpoll = 0,
+        // Completions from io_uring: multishot accept, receives into
+        // buffers provided to the kernel, batched submissions.
+        kIoUring = 1,
+    };
+
+    enum class CreateError {
+        kUnknown = -1,
+        kOk = 0,
+        kNotSupported = 1,
+    };
+
+    enum class WatchError {
+        kUnknown = -1,
+        kOk = 0,
+    };
+
+    enum class WaitError {
+        kUnknown = -1,
+        kOk = 0,
+        kInterrupt = 1,
+    };
+
+    struct Event {
+        enum class Type {
+            // The connection has data to read or was closed.
+            kReadable,
+            // The listening socket has connections to accept().
+            kAcceptable,
+            // A connection was accepted by the loop itself.
+            kAccepted,
+            // Data was received into a loop buffer, which stays valid until
+            // releaseBuffer(). Zero length means the peer closed the
+            // connection.
+            kReceived,
+        };
+
+        Type type = Type::kReadable;
+        void* data = nullptr;
+        SocketDescriptor accepted_descriptor = 0;
+        const char* received_data = nullptr;
+        size_t received_length = 0;
+        uint16_t buffer_id = 0;
+    };
+
+    static std::unique_ptr<EventLoop> create(Backend backend,
+                                             CreateError& error);
+
+    // Whether the backend can be created on this system.
+    static bool isSupported(Backend backend);
+
+    virtual ~EventLoop() = default;
+
+    // Starts accepting connections of a non-blocking listening socket.
+    virtual WatchError addListener(SocketDescriptor descriptor,
+                                   void* data) = 0;
+
+    // Watches the listening socket again after kAcceptable.
+    virtual WatchError rearmListener(SocketDescriptor descriptor,
+                                     void* data) = 0;
+
+    // Starts watching a connection for incoming data or a closed
+    // connection. The data pointer is reported by wait().
+    virtual WatchError add(SocketDescriptor descriptor, void* data) = 0;
+
+    // Watches a reported connection again.
+    virtual WatchError rearm(SocketDescriptor descriptor, void* data) = 0;
+
+    // Stops watching a connection. Must be called before it is closed.
+    virtual void remove(SocketDescriptor descriptor, void* data) = 0;
+
+    // Gives the buffer of a kReceived event back to the loop.
+    virtual void releaseBuffer(const Event& event) = 0;
+
+    // Stores ready events and returns their count, zero on timeout or
+    // wake(). A negative timeout waits indefinitely.
+    virtual size_t wait(Event* events, size_t events_capacity,
+                        std::chrono::milliseconds timeout,
+                        WaitError& error) = 0;
+
+    // Interrupts a wait() running on another thread.
+    virtual void wake() = 0;
+};
+
+}  // namespace simple_http
@@ -0,0 +1,173 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "file.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#ifdef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#elif __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#undef min
+
+namespace simple_http {
+
+constexpr FileDescriptor kInvalidFileDescriptor = -1;
+
+#ifdef _WIN32
+
+static File::Status MakeStatus(const struct ::_stat64& status) {
+    File::Status result;
+    result.size = static_cast<uint64_t>(status.st_size);
+    result.device = static_cast<uint64_t>(status.st_dev);
+    result.inode = static_cast<uint64_t>(status.st_ino);
+    result.modification_time = static_cast<int64_t>(status.st_mtime);
+    return result;
+}
+
+std::unique_ptr<File> File::open(const std::filesystem::path& path,
+                                 File::OpenError& error) {
+    FileDescriptor descriptor =
+        ::_wopen(path.c_str(), _O_RDONLY | _O_BINARY | _O_NOINHERIT);
+    if (descriptor == kInvalidFileDescriptor) {
+        error = errno == ENOENT ? File::OpenError::kNotFound
+                                : File::OpenError::kUnknown;
+        return nullptr;
+    }
+
+    struct ::_stat64 status;
+    if (::_fstat64(descriptor, &status) != 0) {
+        ::_close(descriptor);
+        error = File::OpenError::kUnknown;
+        return nullptr;
+    }
+
+    error = File::OpenError::kOk;
+    return std::unique_ptr<File>(new File(descriptor, MakeStatus(status)));
+}
+
+File::Status File::readStatus(const std::filesystem::path& path,
+                              File::OpenError& error) {
+    struct ::_stat64 status;
+    if (::_wstat64(path.c_str(), &status) != 0) {
+        error = errno == ENOENT ? File::OpenError::kNotFound
+                                : File::OpenError::kUnknown;
+        return File::Status();
+    }
+
+    error = File::OpenError::kOk;
+    return MakeStatus(status);
+}
+
+size_t File::read(FileDescriptor descriptor, char* buffer, size_t length,
+                  uint64_t offset, File::ReadError& error) {
+    if (::_lseeki64(descriptor, static_cast<__int64>(offset), SEEK_SET) < 0) {
+        error = File::ReadError::kUnknown;
+        return 0;
+    }
+
+    int bytes_count = ::_read(descriptor, buffer,
+                              static_cast<unsigned int>(std::min(
+                                  length, static_cast<size_t>(INT_MAX))));
+    if (bytes_count < 0) {
+        error = File::ReadError::kUnknown;
+        return 0;
+    }
+
+    error = File::ReadError::kOk;
+    return static_cast<size_t>(bytes_count);
+}
+
+File::~File() { ::_close(descriptor_); }
+
+#elif __linux__
+
+static File::Status MakeStatus(const struct ::stat& status) {
+    File::Status result;
+    result.size = static_cast<uint64_t>(status.st_size);
+    result.device = static_cast<uint64_t>(status.st_dev);
+    result.inode = static_cast<uint64_t>(status.st_ino);
+    result.modification_time =
+        static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 +
+        status.st_mtim.tv_nsec;
+    return result;
+}
+
+std::unique_ptr<File> File::open(const std::filesystem::path& path,
+                                 File::OpenError& error) {
+    FileDescriptor descriptor;
+    do {
+        descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    } while (descriptor == kInvalidFileDescriptor && errno == EINTR);
+
+    if (descriptor == kInvalidFileDescriptor) {
+        error = errno == ENOENT ? File::OpenError::kNotFound
+                                : File::OpenError::kUnknown;
+        return nullptr;
+    }
+
+    struct ::stat status;
+    if (::fstat(descriptor, &status) != 0) {
+        ::close(descriptor);
+        error = File::OpenError::kUnknown;
+        return nullptr;
+    }
+
+    error = File::OpenError::kOk;
+    return std::unique_ptr<File>(new File(descriptor, MakeStatus(status)));
+}
+
+File::Status File::readStatus(const std::filesystem::path& path,
+                              File::OpenError& error) {
+    struct ::stat status;
+    if (::stat(path.c_str(), &status) != 0) {
+        error = errno == ENOENT ? File::OpenError::kNotFound
+                                : File::OpenError::kUnknown;
+        return File::Status();
+    }
+
+    error = File::OpenError::kOk;
+    return MakeStatus(status);
+}
+
+size_t File::read(FileDescriptor descriptor, char* buffer, size_t length,
+                  uint64_t offset, File::ReadError& error) {
+    ssize_t bytes_count;
+    do {
+        bytes_count = ::pread(descriptor, buffer, length,
+                              static_cast<off_t>(offset));
+    } while (bytes_count < 0 && errno == EINTR);
+
+    if (bytes_count < 0) {
+        error = File::ReadError::kUnknown;
+        return 0;
+    }
+
+    error = File::ReadError::kOk;
+    return static_cast<size_t>(bytes_count);
+}
+
+File::~File() { ::close(descriptor_); }
+
+#endif
+
+}  // namespace simple_http
@@ -0,0 +1,78 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace simple_http {
+
+// A POSIX file descriptor (a C runtime one on Windows).
+typedef int FileDescriptor;
+
+// A file opened for reading.
+class File {
+   public:
+    enum class OpenError {
+        kUnknown = -1,
+        kOk = 0,
+        kNotFound = 1,
+    };
+
+    enum class ReadError {
+        kUnknown = -1,
+        kOk = 0,
+    };
+
+    // Tells whether the file at a path was changed or replaced.
+    struct Status {
+        uint64_t size = 0;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        // Nanoseconds since the epoch, seconds on Windows.
+        int64_t modification_time = 0;
+
+        bool operator==(const Status& other) const = default;
+    };
+
+    static std::unique_ptr<File> open(const std::filesystem::path& path,
+                                      OpenError& error);
+
+    // Gets the status of the file at the path without opening it.
+    static Status readStatus(const std::filesystem::path& path,
+                             OpenError& error);
+
+    // Reads up to length bytes starting at offset without moving the file
+    // position. Returns 0 at the end of the file.
+    static size_t read(FileDescriptor descriptor, char* buffer, size_t length,
+                       uint64_t offset, ReadError& error);
+
+    File() = delete;
+
+    ~File();
+
+    size_t read(char* buffer, size_t length, uint64_t offset,
+                ReadError& error) {
+        return read(descriptor_, buffer, length, offset, error);
+    };
+
+    FileDescriptor getDescriptor() const { return descriptor_; };
+
+    // The size at the time the file was opened.
+    uint64_t getSize() const { return status_.size; };
+
+    // The status at the time the file was opened.
+    const Status& getStatus() const { return status_; };
+
+   private:
+    File(FileDescriptor descriptor, const Status& status)
+        : descriptor_(descriptor), status_(status){};
+
+    FileDescriptor descriptor_;
+    Status status_;
+};
+
+}  // namespace simple_http
@@ -6,9 +6,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <chrono>
 #include <memory>
 #include <string_view>
 
+#include "byte_scanner.h"
+#include "char_classes.h"
 #include "content_length_message_body.h"
 #include "http_connection_handler.h"
 #include "http_parser.h"
@@ -20,43 +24,129 @@
 
 namespace simple_http {
 
-static size_t FindCRLF(const char* buffer, size_t buffer_length) {
-    for (size_t i = 0; i < buffer_length - 1; i++) {
-        if (buffer[i] == '\r' && buffer[i + 1] == '\n') {
-            return i;
+HttpConnection::ProccessRequestError HttpConnection::proccessRequests(
+    const HttpConnectionHandler& handler) {
+    ProccessRequestError error;
+    do {
+        error = proccessRequest(handler);
+    } while (error == ProccessRequestError::kOk && !socket_->isClosed());
+
+    return error;
+}
+
+HttpConnection::ProccessRequestError HttpConnection::resume(
+    const HttpConnectionHandler& handler) {
+    while (true) {
+        input_.setSuspendable(true);
+        ProccessRequestError error = receiveRequest();
+        input_.setSuspendable(false);
+        if (error == ProccessRequestError::kWouldBlock &&
+            output_.flush() != SocketWriter::FlushError::kOk) {
+            return ProccessRequestError::kConnectionClosed;
+        }
+
+        if (error != ProccessRequestError::kOk) {
+            return error;
+        }
+
+        error = handleRequest(handler);
+        if (error != ProccessRequestError::kOk || socket_->isClosed()) {
+            return error;
         }
     }
+}
 
-    return -1;
+void HttpConnection::attachBuffers(std::vector<char>& request_buffer,
+                                   std::vector<char>& response_buffer,
+                                   RequestArena& arena) {
+    input_.setBuffer(request_buffer.data(), request_buffer.size());
+    output_.setBuffer(response_buffer.data(), response_buffer.size());
+    arena_ = &arena;
+    pending_input_ = std::vector<char>();
 }
 
-static size_t IsEqualsCaseInsensitive(const std::string_view& first,
-                                      const std::string_view& second) {
-    if (first.length() != second.length()) {
-        return false;
+void HttpConnection::detachBuffers() {
+    // A request that failed after its head was parsed leaves it pinned.
+    input_.unpin();
+    SocketReader::ReadResult buffered = input_.peek();
+    pending_input_.resize(buffered.getLength());
+    input_.setBuffer(pending_input_.data(), pending_input_.size());
+    input_.clearReceivedData();
+    // Responses held back for pipelined requests are sent before the buffer
+    // goes back to the worker.
+    if (socket_->isClosed()) {
+        output_.discard();
+    } else {
+        output_.flush();
     }
+    output_.setBuffer(nullptr, 0);
+    arena_ = nullptr;
+}
 
-    for (size_t i = 0; i < first.length(); i++) {
-        if (::tolower(first[i]) != ::tolower(second[i])) {
-            return false;
-        }
-    }
+void HttpConnection::setReceivedData(const char* data, size_t length) {
+    input_.setReceivedData(data, length);
+}
 
-    return true;
+bool HttpConnection::isIdle() const {
+    return (processing_state_ == RequestProcessingState::kInitial ||
+            processing_state_ == RequestProcessingState::kRequestLine) &&
+           !input_.hasBufferedData();
 }
 
 HttpConnection::ProccessRequestError HttpConnection::proccessRequest(
-    HttpConnectionHandler handler) {
+    const HttpConnectionHandler& handler) {
     assert(processing_state_ == RequestProcessingState::kInitial);
 
-    processing_state_ = RequestProcessingState::kRequestLine;
+    if (requests_count_ != 0 && !input_.hasBufferedData()) {
+        Socket::WaitError wait_error;
+        wait_error = socket_->waitReadable(options_.keep_alive_timeout);
+        if (wait_error != Socket::WaitError::kOk) {
+            closeConnection();
+            return ProccessRequestError::kConnectionClosed;
+        }
+    }
+
+    ProccessRequestError error = receiveRequest();
+    if (error != ProccessRequestError::kOk) {
+        return error;
+    }
+
+    return handleRequest(handler);
+}
+
+HttpConnection::ProccessRequestError HttpConnection::receiveRequest() {
+    if (processing_state_ == RequestProcessingState::kInitial) {
+        requests_count_++;
+        processing_state_ = RequestProcessingState::kRequestLine;
+        if (options_.header_timeout.count() > 0) {
+            input_.setDeadline(std::chrono::steady_clock::now() +
+                               options_.header_timeout);
+        }
+    }
+
     do {
         SocketReader::ReadError read_error;
         SocketReader::ReadResult read_result = input_.read(read_error);
+        if (read_error == SocketReader::ReadError::kWouldBlock) {
+            return ProccessRequestError::kWouldBlock;
+        }
+
+        if (read_error == SocketReader::ReadError::kTimedOut) {
+            sendRequestTimeout();
+            return ProccessRequestError::kTimedOut;
+        }
+
         if (read_error != SocketReader::ReadError::kOk) {
             return ProccessRequestError::kConnectionClosed;
         }
 
+        // The client closed the connection between requests.
+        if (processing_state_ == RequestProcessingState::kRequestLine &&
+            read_result.isCompleted() && read_result.getLength() == 0) {
+            closeConnection();
+            return ProccessRequestError::kConnectionClosed;
+        }
+
         ParseError parse_error = parseRequest(read_result);
         if (parse_error != ParseError::kOk) {
             sendBadRequest();
@@ -64,29 +154,70 @@ HttpConnection::ProccessRequestError HttpConnection::proccessRequest(
         }
     } while (processing_state_ != RequestProcessingState::kParsed);
 
-    if (takeMessageBody() != ParseError::kOk) {
+    input_.setDeadline(std::chrono::steady_clock::time_point::max());
+    return ProccessRequestError::kOk;
+}
+
+HttpConnection::ProccessRequestError HttpConnection::handleRequest(
+    const HttpConnectionHandler& handler) {
+    ParseError body_error = takeMessageBody();
+    if (body_error == ParseError::kNotImplemented) {
+        sendNotImplemented();
+        return ProccessRequestError::kBadSyntax;
+    }
+
+    if (body_error != ParseError::kOk) {
         sendBadRequest();
         return ProccessRequestError::kBadSyntax;
     }
 
+    // Reading the body may block, so responses held back for pipelined
+    // requests have to reach the client first.
+    if (request_data_.content_length != 0 &&
+        output_.flush() != SocketWriter::FlushError::kOk) {
+        return ProccessRequestError::kConnectionClosed;
+    }
+
+    request_data_.keep_alive = requests_count_ < options_.max_requests &&
+                               isKeepAliveRequested();
+
+    // The response is kept in the output buffer while the next request is
+    // already received, and goes out together with the following ones.
+    bool is_pipelined = request_data_.keep_alive &&
+                        request_data_.content_length == 0 &&
+                        hasPipelinedRequest();
+
     IncomingMessage request(request_data_);
-    OutgoingMessage response(request_data_, output_);
+    // Objects of the previous request on this thread are gone by now.
+    arena_->reset();
+    OutgoingMessage response(request_data_, output_, is_pipelined, arena_);
     try {
         handler(request, response);
     } catch (...) {
+        if (!response.isStarted() && input_.isTimedOut()) {
+            sendRequestTimeout();
+            return ProccessRequestError::kTimedOut;
+        }
+
         if (!response.isStarted()) {
             sendInternalError();
         }
         return ProccessRequestError::kHandlerException;
     }
 
+    // The handler gave up on a body that arrived too slowly.
+    if (!response.isStarted() && input_.isTimedOut()) {
+        sendRequestTimeout();
+        return ProccessRequestError::kTimedOut;
+    }
+
     if (!response.isStarted()) {
         sendInternalError();
         return ProccessRequestError::kHandlerException;
     }
 
     if (!response.isEnded()) {
-        socket_->close();
+        closeConnection();
         return ProccessRequestError::kHandlerException;
     }
 
@@ -97,64 +228,82 @@ HttpConnection::ProccessRequestError HttpConnection::proccessRequest(
     MessageBody::ReadError consume_error;
     consume_error = request_data_.body->consume();
     if (consume_error == MessageBody::ReadError::kBadSyntax) {
-        socket_->close();
+        closeConnection();
         return ProccessRequestError::kBadSyntax;
     }
 
+    // The response is already sent, the connection is just dropped.
+    if (consume_error == MessageBody::ReadError::kTimedOut) {
+        closeConnection();
+        return ProccessRequestError::kTimedOut;
+    }
+
     if (consume_error != MessageBody::ReadError::kOk) {
         return ProccessRequestError::kConnectionClosed;
     }
 
-    socket_->close();
-    return ProccessRequestError::kOk;
-}
-
-HttpConnection::ParseError HttpConnection::parseRequest(
-    SocketReader::ReadResult result) {
-    switch (processing_state_) {
-        case RequestProcessingState::kRequestLine:
-            return takeRequestLine(result);
-        case RequestProcessingState::kHeaders:
-            return takeHeader(result);
-        case RequestProcessingState::kParsed:
-            return ParseError::kOk;
+    bool keep_alive = response.isKeepAlive();
+    reset();
+    if (!keep_alive) {
+        closeConnection();
     }
 
-    return ParseError::kBadRequest;
+    return ProccessRequestError::kOk;
 }
 
-HttpConnection::ParseError HttpConnection::takeRequestLine(
+HttpConnection::ParseError HttpConnection::parseRequest(
     SocketReader::ReadResult result) {
-    size_t crlf_index = FindCRLF(result.getBuffer(), result.getLength());
-    if (crlf_index == -1) {
-        if (result.isCompleted()) {
+    while (processing_state_ != RequestProcessingState::kParsed) {
+        HttpParser::ParseError parse_error;
+        HttpParser::ParseResult parse_result = parser_.parse(
+            result.getBuffer(), result.getLength(), parse_error);
+        if (parse_error != HttpParser::ParseError::kOk) {
             return ParseError::kBadRequest;
         }
 
-        input_.advance(0, result.getLength());
-        return ParseError::kOk;
+        ParseError error = ParseError::kOk;
+        switch (parse_result) {
+            case HttpParser::ParseResult::kIncomplete:
+                return waitRequestData(result);
+            case HttpParser::ParseResult::kRequestLine:
+                error = proccessRequestLine(parser_.getRequestLine());
+                break;
+            case HttpParser::ParseResult::kHeader:
+                error = proccessHeader(parser_.getHeader());
+                break;
+            case HttpParser::ParseResult::kHeadersEnd:
+                processing_state_ = RequestProcessingState::kParsed;
+                break;
+        }
+
+        if (error != ParseError::kOk) {
+            return error;
+        }
     }
 
-    std::string_view line(result.getBuffer(), crlf_index);
-    HttpParser::ParseRequestLineError parse_error;
-    auto parse_result = parser_.parseRequestLine(line, parse_error);
-    if (!parse_result.has_value() ||
-        parse_error != HttpParser::ParseRequestLineError::kOk) {
+    // Request data points into the head, so it stays in the buffer until the
+    // response ends.
+    input_.pin(parser_.getParsedBytes());
+    return ParseError::kOk;
+}
+
+HttpConnection::ParseError HttpConnection::waitRequestData(
+    SocketReader::ReadResult result) {
+    if (result.isCompleted()) {
         return ParseError::kBadRequest;
     }
 
-    HttpParser::RequestLine request_line = parse_result.value();
-    ParseError error = proccessRequestLine(request_line);
-    if (error != ParseError::kOk) {
-        return error;
+    // The whole request head has to fit the buffer.
+    if (input_.isFull()) {
+        return ParseError::kLimitsExceeded;
     }
 
-    input_.advance(line.length() + 2);
+    input_.advance(0, result.getLength());
     return ParseError::kOk;
 }
 
 HttpConnection::ParseError HttpConnection::proccessRequestLine(
-    HttpParser::RequestLine request_line) {
+    const HttpParser::RequestLine& request_line) {
     if (request_line.version.has_value()) {
         auto version = request_line.version.value();
         if (version.major.length() > 1 || version.minor.length() > 1) {
@@ -193,10 +342,12 @@ HttpConnection::ParseError HttpConnection::proccessRequestLine(
             request_data_.method_name = "POST";
         } else {
             request_data_.method = HttpMethod::kCustom;
-            request_data_.method_name = request_line.method;
-            std::transform(request_data_.method_name.begin(),
-                           request_data_.method_name.end(),
-                           request_data_.method_name.begin(), ::toupper);
+            request_data_.custom_method_name = request_line.method;
+            std::transform(request_data_.custom_method_name.begin(),
+                           request_data_.custom_method_name.end(),
+                           request_data_.custom_method_name.begin(),
+                           ::toupper);
+            request_data_.method_name = request_data_.custom_method_name;
         }
     }
 
@@ -222,70 +373,40 @@ HttpConnection::ParseError HttpConnection::proccessRequestLine(
     return ParseError::kOk;
 }
 
-HttpConnection::ParseError HttpConnection::takeHeader(
-    SocketReader::ReadResult result) {
-    size_t crlf_index = FindCRLF(result.getBuffer(), result.getLength());
-    if (crlf_index == -1) {
-        if (result.isCompleted()) {
-            return ParseError::kBadRequest;
-        }
-
-        input_.advance(0, result.getLength());
-        return ParseError::kOk;
-    }
-
-    if (crlf_index == 0) {
-        input_.advance(2);
-        processing_state_ = RequestProcessingState::kParsed;
-        return ParseError::kOk;
-    }
-
-    std::string_view line(result.getBuffer(), crlf_index);
-    HttpParser::ParseRequestHeaderError parse_error;
-    auto parse_result = parser_.parseRequestHeader(line, parse_error);
-    if (!parse_result.has_value() ||
-        parse_error != HttpParser::ParseRequestHeaderError::kOk) {
-        return ParseError::kBadRequest;
-    }
-
-    HttpParser::RequestHeader header = parse_result.value();
-    ParseError error = proccessHeader(header);
-    if (error != ParseError::kOk) {
-        return error;
-    }
-
-    input_.advance(line.length() + 2);
-    return ParseError::kOk;
-}
-
 HttpConnection::ParseError HttpConnection::proccessHeader(
-    HttpParser::RequestHeader header) {
-    std::string name(header.name);
-    std::string value(header.value);
-    request_data_.headers.add(std::move(name), std::move(value));
+    const HttpParser::RequestHeader& header) {
+    request_data_.headers.addView(header.name, header.value);
     return ParseError::kOk;
 }
 
 HttpConnection::ParseError HttpConnection::takeMessageBody() {
     if (request_data_.http_version == HttpVersion::kHttp09) {
-        request_data_.body = std::make_unique<ZeroMessageBody>();
+        request_data_.body = &zero_body_;
         request_data_.content_length = 0;
         return ParseError::kOk;
     }
 
-    auto headers_search_result = request_data_.headers.get("Content-Length");
+    // Without decoding a chunked body its data would be taken for the next
+    // request on the connection, so such requests are refused.
+    if (request_data_.headers.count(HttpHeaderId::kTransferEncoding) != 0) {
+        return request_data_.headers.count(HttpHeaderId::kContentLength) != 0
+                   ? ParseError::kBadRequest
+                   : ParseError::kNotImplemented;
+    }
+
+    auto headers_search_result =
+        request_data_.headers.get(HttpHeaderId::kContentLength);
     if (!headers_search_result.has_value()) {
-        request_data_.body = std::make_unique<ZeroMessageBody>();
+        request_data_.body = &zero_body_;
         request_data_.content_length = 0;
         return ParseError::kOk;
     }
 
-    auto headers = headers_search_result.value();
-    if (headers.size() > 1) {
+    if (request_data_.headers.count(HttpHeaderId::kContentLength) > 1) {
         return ParseError::kBadRequest;
     }
 
-    const std::string& header = headers[0];
+    std::string_view header = headers_search_result.value();
     if (header.length() > sizeof(size_t)) {
         return ParseError::kBadRequest;
     }
@@ -296,41 +417,142 @@ HttpConnection::ParseError HttpConnection::takeMessageBody() {
         }
     }
 
-    size_t content_length = std::stoll(header);
-    if (content_length < 0) {
+    size_t content_length;
+    auto [end, error] = std::from_chars(
+        header.data(), header.data() + header.length(), content_length);
+    if (error != std::errc()) {
         return ParseError::kBadRequest;
     }
 
     if (content_length > 0) {
-        request_data_.body =
-            std::make_unique<ContentLengthMessageBody>(input_, content_length);
+        content_length_body_.emplace(input_, content_length,
+                                     options_.min_body_rate,
+                                     socket_->getReadTimeout());
+        request_data_.body = &*content_length_body_;
         request_data_.content_length = content_length;
         return ParseError::kOk;
     }
 
-    request_data_.body = std::make_unique<ZeroMessageBody>();
+    request_data_.body = &zero_body_;
     request_data_.content_length = 0;
     return ParseError::kOk;
 }
 
+bool HttpConnection::isKeepAliveRequested() {
+    if (request_data_.http_version == HttpVersion::kNone ||
+        request_data_.http_version == HttpVersion::kHttp09) {
+        return false;
+    }
+
+    // HTTP/1.1 connections are persistent by default, HTTP/1.0 ones only
+    // on explicit request.
+    bool keep_alive = request_data_.http_version == HttpVersion::kHttp11;
+    for (const HttpHeaders::Header& header : request_data_.headers) {
+        if (header.id != HttpHeaderId::kConnection) {
+            continue;
+        }
+
+        std::string_view value = header.value;
+        size_t start = 0;
+        while (start <= value.length()) {
+            size_t end = value.find(',', start);
+            if (end == std::string_view::npos) {
+                end = value.length();
+            }
+
+            std::string_view token(value.data() + start, end - start);
+            while (!token.empty() &&
+                   (token.front() == ' ' || token.front() == '\t')) {
+                token.remove_prefix(1);
+            }
+            while (!token.empty() &&
+                   (token.back() == ' ' || token.back() == '\t')) {
+                token.remove_suffix(1);
+            }
+
+            if (IsEqualsCaseInsensitive(token, "close")) {
+                return false;
+            } else if (IsEqualsCaseInsensitive(token, "keep-alive")) {
+                keep_alive = true;
+            }
+
+            start = end + 1;
+        }
+    }
+
+    return keep_alive;
+}
+
+bool HttpConnection::hasPipelinedRequest() {
+    SocketReader::ReadResult buffered = input_.peek();
+    const char* data = buffered.getBuffer();
+    size_t length = buffered.getLength();
+    size_t index = 0;
+    while (true) {
+        size_t crlf_index = FindCRLF(data + index, length - index);
+        if (crlf_index == kNotFound) {
+            return false;
+        }
+
+        index += crlf_index + 2;
+        if (index + 1 < length && data[index] == '\r' &&
+            data[index + 1] == '\n') {
+            return true;
+        }
+    }
+}
+
+void HttpConnection::reset() {
+    processing_state_ = RequestProcessingState::kInitial;
+    parser_.reset();
+    input_.unpin();
+    input_.setDeadline(std::chrono::steady_clock::time_point::max());
+    request_data_ = HttpRequestData();
+}
+
+void HttpConnection::closeConnection() {
+    if (socket_->isClosed()) {
+        return;
+    }
+
+    output_.flush();
+    socket_->close();
+}
+
 void HttpConnection::sendBadRequest() {
     if (request_data_.http_version != HttpVersion::kNone &&
         request_data_.http_version != HttpVersion::kHttp09) {
-        output_.write("HTTP/1.0 400 Bad Request\r\n\r\n");
-        output_.flush();
+        output_.write(GetResponseVersionName(request_data_.http_version));
+        output_.write(" 400 Bad Request\r\nConnection: close\r\n\r\n");
     }
 
-    socket_->close();
+    closeConnection();
 }
 
 void HttpConnection::sendInternalError() {
     if (request_data_.http_version != HttpVersion::kNone &&
         request_data_.http_version != HttpVersion::kHttp09) {
-        output_.write("HTTP/1.0 500 Internal Server Error\r\n\r\n");
-        output_.flush();
+        output_.write(GetResponseVersionName(request_data_.http_version));
+        output_.write(
+            " 500 Internal Server Error\r\nConnection: close\r\n\r\n");
     }
 
-    socket_->close();
+    closeConnection();
+}
+
+void HttpConnection::sendNotImplemented() {
+    output_.write(GetResponseVersionName(request_data_.http_version));
+    output_.write(" 501 Not Implemented\r\nConnection: close\r\n\r\n");
+    closeConnection();
+}
+
+void HttpConnection::sendRequestTimeout() {
+    if (request_data_.http_version != HttpVersion::kHttp09) {
+        output_.write(GetResponseVersionName(request_data_.http_version));
+        output_.write(" 408 Request Timeout\r\nConnection: close\r\n\r\n");
+    }
+
+    closeConnection();
 }
 
 }  // namespace simple_http
@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 
+#include "content_length_message_body.h"
 #include "http_connection_handler.h"
 #include "http_headers.h"
 #include "http_method.h"
@@ -17,8 +20,10 @@
 #include "incoming_message.h"
 #include "message_body.h"
 #include "outgoing_message.h"
+#include "request_arena.h"
 #include "socket_reader.h"
 #include "socket_writer.h"
+#include "zero_message_body.h"
 
 namespace simple_http {
 class HttpConnection {
@@ -28,17 +33,69 @@ class HttpConnection {
         kConnectionClosed = 1,
         kBadSyntax = 2,
         kHandlerException = 3,
+        kWouldBlock = 4,
+        kTimedOut = 5,
+    };
+
+    struct Options {
+        // Maximum number of requests served over one connection.
+        size_t max_requests = 100;
+        // How long an open connection may wait for the next request.
+        std::chrono::milliseconds keep_alive_timeout =
+            std::chrono::milliseconds(5000);
+        // How long the request line and headers may take together, counting
+        // from the first read of the request. Zero means no limit.
+        std::chrono::milliseconds header_timeout =
+            std::chrono::milliseconds(10000);
+        // Bytes per second a body must keep up after the socket read
+        // timeout. Zero means no limit.
+        size_t min_body_rate = 0;
     };
 
     HttpConnection() = delete;
 
-    HttpConnection(Socket* socket, std::vector<char>& request_buffer,
-                   std::vector<char>& response_buffer)
+    // The arena holds objects of a request while it is handled.
+    HttpConnection(Socket* socket, const Options& options,
+                   std::vector<char>& request_buffer,
+                   std::vector<char>& response_buffer, RequestArena& arena)
         : socket_(socket),
+          options_(options),
           input_(socket, request_buffer.data(), request_buffer.size()),
-          output_(socket, response_buffer.data(), response_buffer.size()){};
+          output_(socket, response_buffer.data(), response_buffer.size()),
+          arena_(&arena){};
+
+    // Creates a connection without buffers, they are given by
+    // attachBuffers() for each resume().
+    HttpConnection(Socket* socket, const Options& options)
+        : socket_(socket),
+          options_(options),
+          input_(socket, nullptr, 0),
+          output_(socket, nullptr, 0){};
+
+    // Serves requests until the connection is closed by either side.
+    ProccessRequestError proccessRequests(const HttpConnectionHandler& handler);
+
+    // Serves requests from a non-blocking socket until it has no more data,
+    // then returns kWouldBlock with the progress kept in the connection.
+    ProccessRequestError resume(const HttpConnectionHandler& handler);
 
-    ProccessRequestError proccessRequest(HttpConnectionHandler handler);
+    void attachBuffers(std::vector<char>& request_buffer,
+                       std::vector<char>& response_buffer,
+                       RequestArena& arena);
+
+    // Keeps unprocessed input in the connection itself while it waits for
+    // more data. Output must be flushed.
+    void detachBuffers();
+
+    // Gives data received by an event loop to the next resume(). Empty data
+    // means the client closed the connection.
+    void setReceivedData(const char* data, size_t length);
+
+    // Whether the connection waits for the next request.
+    bool isIdle() const;
+
+    // Requests started on the connection so far.
+    size_t getRequestsCount() const { return requests_count_; };
 
    private:
     enum class RequestProcessingState {
@@ -57,27 +114,49 @@ class HttpConnection {
         kOk = 0,
         kBadRequest = 1,
         kLimitsExceeded = 2,
+        // A transfer coding, which is not supported.
+        kNotImplemented = 3,
     };
 
-    ParseError parseRequest(SocketReader::ReadResult result);
+    ProccessRequestError proccessRequest(const HttpConnectionHandler& handler);
 
-    ParseError takeRequestLine(SocketReader::ReadResult result);
+    ProccessRequestError receiveRequest();
 
-    ParseError proccessRequestLine(HttpParser::RequestLine request_line);
+    ProccessRequestError handleRequest(const HttpConnectionHandler& handler);
 
-    ParseError takeHeader(SocketReader::ReadResult result);
+    ParseError parseRequest(SocketReader::ReadResult result);
+
+    ParseError waitRequestData(SocketReader::ReadResult result);
+
+    ParseError proccessRequestLine(const HttpParser::RequestLine& request_line);
 
-    ParseError proccessHeader(HttpParser::RequestHeader header);
+    ParseError proccessHeader(const HttpParser::RequestHeader& header);
 
     ParseError takeMessageBody();
 
+    bool isKeepAliveRequested();
+
+    bool hasPipelinedRequest();
+
+    void reset();
+
+    // Sends what the output buffer holds, e.g. responses held back for
+    // pipelined requests, then closes the socket.
+    void closeConnection();
+
     void sendBadRequest();
 
     void sendInternalError();
 
+    void sendNotImplemented();
+
+    void sendRequestTimeout();
+
     Socket* socket_;
+    Options options_;
     SocketReader input_;
     SocketWriter output_;
+    RequestArena* arena_ = nullptr;
 
     HttpParser parser_;
     HttpUriParser uri_parser_;
@@ -85,5 +164,11 @@ class HttpConnection {
     RequestProcessingState processing_state_ = RequestProcessingState::kInitial;
 
     HttpRequestData request_data_;
+    ZeroMessageBody zero_body_;
+    std::optional<ContentLengthMessageBody> content_length_body_;
+
+    size_t requests_count_ = 0;
+
+    std::vector<char> pending_input_;
 };
 }  // namespace simple_http
@@ -5,52 +5,211 @@
 #include "http_headers.h"
 
 #include <algorithm>
-#include <map>
+#include <array>
+#include <cstdint>
 #include <optional>
-#include <string>
-#include <utility>
-#include <vector>
+#include <string_view>
+
+#include "char_classes.h"
 
 namespace simple_http {
 
-void HttpHeaders::add(const std::string& name, const std::string& value) {
-    std::string normilized_name = name;
-    std::transform(normilized_name.begin(), normilized_name.end(),
-                   normilized_name.begin(), ::tolower);
+struct KnownHeader {
+    HttpHeaderId id;
+    std::string_view name;
+    uint32_t hash;
+};
+
+// FNV-1a over lowercased bytes.
+static constexpr uint32_t HashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char symbol : name) {
+        hash ^= static_cast<unsigned char>(ToLowerAscii(symbol));
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static constexpr KnownHeader MakeKnownHeader(HttpHeaderId id,
+                                             std::string_view name) {
+    return KnownHeader{id, name, HashName(name)};
+}
+
+// Ordered by id.
+static constexpr std::array kKnownHeaders{
+    MakeKnownHeader(HttpHeaderId::kOther, ""),
+    MakeKnownHeader(HttpHeaderId::kAccept, "Accept"),
+    MakeKnownHeader(HttpHeaderId::kAcceptEncoding, "Accept-Encoding"),
+    MakeKnownHeader(HttpHeaderId::kAcceptLanguage, "Accept-Language"),
+    MakeKnownHeader(HttpHeaderId::kAuthorization, "Authorization"),
+    MakeKnownHeader(HttpHeaderId::kCacheControl, "Cache-Control"),
+    MakeKnownHeader(HttpHeaderId::kConnection, "Connection"),
+    MakeKnownHeader(HttpHeaderId::kContentEncoding, "Content-Encoding"),
+    MakeKnownHeader(HttpHeaderId::kContentLength, "Content-Length"),
+    MakeKnownHeader(HttpHeaderId::kContentType, "Content-Type"),
+    MakeKnownHeader(HttpHeaderId::kCookie, "Cookie"),
+    MakeKnownHeader(HttpHeaderId::kDate, "Date"),
+    MakeKnownHeader(HttpHeaderId::kETag, "ETag"),
+    MakeKnownHeader(HttpHeaderId::kExpect, "Expect"),
+    MakeKnownHeader(HttpHeaderId::kHost, "Host"),
+    MakeKnownHeader(HttpHeaderId::kIfModifiedSince, "If-Modified-Since"),
+    MakeKnownHeader(HttpHeaderId::kIfNoneMatch, "If-None-Match"),
+    MakeKnownHeader(HttpHeaderId::kLastModified, "Last-Modified"),
+    MakeKnownHeader(HttpHeaderId::kLocation, "Location"),
+    MakeKnownHeader(HttpHeaderId::kRange, "Range"),
+    MakeKnownHeader(HttpHeaderId::kRetryAfter, "Retry-After"),
+    MakeKnownHeader(HttpHeaderId::kServer, "Server"),
+    MakeKnownHeader(HttpHeaderId::kSetCookie, "Set-Cookie"),
+    MakeKnownHeader(HttpHeaderId::kTransferEncoding, "Transfer-Encoding"),
+    MakeKnownHeader(HttpHeaderId::kUpgrade, "Upgrade"),
+    MakeKnownHeader(HttpHeaderId::kUserAgent, "User-Agent"),
+    MakeKnownHeader(HttpHeaderId::kVary, "Vary"),
+};
+
+static_assert(static_cast<size_t>(HttpHeaderId::kVary) + 1 ==
+              kKnownHeaders.size());
+
+static HttpHeaderId FindKnownHeader(std::string_view name, uint32_t hash) {
+    for (size_t i = 1; i < kKnownHeaders.size(); i++) {
+        if (kKnownHeaders[i].hash == hash &&
+            IsEqualsCaseInsensitive(kKnownHeaders[i].name, name)) {
+            return kKnownHeaders[i].id;
+        }
+    }
+
+    return HttpHeaderId::kOther;
+}
+
+uint32_t HashHeaderName(std::string_view name) { return HashName(name); }
+
+HttpHeaderId GetHttpHeaderId(std::string_view name) {
+    return FindKnownHeader(name, HashName(name));
+}
+
+std::string_view GetHttpHeaderName(HttpHeaderId id) {
+    return kKnownHeaders[static_cast<size_t>(id)].name;
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value) {
+    uint32_t hash = HashName(name);
+    HttpHeaderId id = FindKnownHeader(name, hash);
+    if (id != HttpHeaderId::kOther) {
+        name = GetHttpHeaderName(id);
+    } else {
+        name = store(name);
+    }
+
+    add(id, hash, name, store(value), true);
+}
+
+void HttpHeaders::add(HttpHeaderId id, std::string_view value) {
+    const KnownHeader& header = kKnownHeaders[static_cast<size_t>(id)];
+    add(id, header.hash, header.name, store(value), true);
+}
+
+void HttpHeaders::addView(std::string_view name, std::string_view value) {
+    uint32_t hash = HashName(name);
+    add(FindKnownHeader(name, hash), hash, name, value, false);
+}
+
+void HttpHeaders::add(HttpHeaderId id, uint32_t hash, std::string_view name,
+                      std::string_view value, bool is_owned) {
+    Header header;
+    header.id = id;
+    header.hash = hash;
+    header.name = name;
+    header.value = value;
+    header.is_owned = is_owned;
+    headers_.push_back(header);
+}
+
+std::optional<std::string_view> HttpHeaders::get(HttpHeaderId id) const {
+    const Header* header = find(id, 0, "");
+    if (header == nullptr) {
+        return std::nullopt;
+    }
+
+    return header->value;
+}
+
+std::optional<std::string_view> HttpHeaders::get(std::string_view name) const {
+    uint32_t hash = HashName(name);
+    const Header* header = find(FindKnownHeader(name, hash), hash, name);
+    if (header == nullptr) {
+        return std::nullopt;
+    }
+
+    return header->value;
+}
 
-    auto it = headers_.find(normilized_name);
-    if (it != headers_.end()) {
-        it->second.push_back(value);
-        return;
+size_t HttpHeaders::count(HttpHeaderId id) const {
+    return std::count_if(
+        headers_.begin(), headers_.end(),
+        [id](const Header& header) { return header.id == id; });
+}
+
+size_t HttpHeaders::count(std::string_view name) const {
+    uint32_t hash = HashName(name);
+    HttpHeaderId id = FindKnownHeader(name, hash);
+    if (id != HttpHeaderId::kOther) {
+        return count(id);
     }
 
-    headers_.insert({normilized_name, {value}});
+    return std::count_if(
+        headers_.begin(), headers_.end(), [&](const Header& header) {
+            return header.hash == hash &&
+                   IsEqualsCaseInsensitive(header.name, name);
+        });
 }
 
-void HttpHeaders::add(std::string&& name, std::string&& value) {
-    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+void HttpHeaders::clear() {
+    for (const Header& header : headers_) {
+        if (!header.is_owned) {
+            continue;
+        }
 
-    auto it = headers_.find(name);
-    if (it != headers_.end()) {
-        it->second.push_back(std::move(value));
-        return;
+        if (header.id == HttpHeaderId::kOther) {
+            release(header.name);
+        }
+        release(header.value);
     }
 
-    headers_.insert({std::move(name), {std::move(value)}});
+    headers_.clear();
 }
 
-std::optional<std::vector<std::string>> HttpHeaders::get(
-    const std::string& name) const {
-    std::string normilized_name = name;
-    std::transform(normilized_name.begin(), normilized_name.end(),
-                   normilized_name.begin(), ::tolower);
+std::string_view HttpHeaders::store(std::string_view data) {
+    if (data.empty()) {
+        return std::string_view();
+    }
+
+    char* destination =
+        static_cast<char*>(resource_->allocate(data.length(), 1));
+    std::copy(data.begin(), data.end(), destination);
+    return std::string_view(destination, data.length());
+}
+
+void HttpHeaders::release(std::string_view data) {
+    if (!data.empty()) {
+        resource_->deallocate(const_cast<char*>(data.data()), data.length(),
+                              1);
+    }
+}
 
-    auto it = headers_.find(normilized_name);
-    if (it != headers_.end()) {
-        return it->second;
+const HttpHeaders::Header* HttpHeaders::find(HttpHeaderId id, uint32_t hash,
+                                             std::string_view name) const {
+    for (const Header& header : headers_) {
+        if (id != HttpHeaderId::kOther) {
+            if (header.id == id) {
+                return &header;
+            }
+        } else if (header.hash == hash &&
+                   IsEqualsCaseInsensitive(header.name, name)) {
+            return &header;
+        }
     }
 
-    return std::nullopt;
+    return nullptr;
 }
 
 }  // namespace simple_http
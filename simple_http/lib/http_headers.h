@@ -4,35 +4,124 @@
 
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <memory_resource>
 #include <optional>
-#include <string>
-#include <vector>
+#include <string_view>
+
+#include "small_vector.h"
 
 namespace simple_http {
 
+// Headers known to the library, they are matched by the id instead of the
+// name.
+enum class HttpHeaderId : uint8_t {
+    kOther = 0,
+    kAccept,
+    kAcceptEncoding,
+    kAcceptLanguage,
+    kAuthorization,
+    kCacheControl,
+    kConnection,
+    kContentEncoding,
+    kContentLength,
+    kContentType,
+    kCookie,
+    kDate,
+    kETag,
+    kExpect,
+    kHost,
+    kIfModifiedSince,
+    kIfNoneMatch,
+    kLastModified,
+    kLocation,
+    kRange,
+    kRetryAfter,
+    kServer,
+    kSetCookie,
+    kTransferEncoding,
+    kUpgrade,
+    kUserAgent,
+    kVary,
+};
+
+// Hash of a header name that ignores the case of ASCII letters.
+uint32_t HashHeaderName(std::string_view name);
+
+HttpHeaderId GetHttpHeaderId(std::string_view name);
+
+// Returns the usual spelling of a known header.
+std::string_view GetHttpHeaderName(HttpHeaderId id);
+
+// Header fields in the order they were added, names are case-insensitive.
+// Up to 16 fields are kept without allocations, copied names and values
+// are allocated from the given memory resource.
 class HttpHeaders {
    public:
-    void add(const std::string& name, const std::string& value);
-    void add(std::string&& name, std::string&& value);
+    struct Header {
+        HttpHeaderId id = HttpHeaderId::kOther;
+        uint32_t hash = 0;
+        std::string_view name;
+        std::string_view value;
+        // Whether the value and a custom name were copied.
+        bool is_owned = false;
+    };
 
-    std::optional<std::vector<std::string>> get(const std::string& name) const;
+    explicit HttpHeaders(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource){};
 
-    std::map<std::string, std::vector<std::string>>::const_iterator find(
-        const std::string& name) const {
-        return headers_.find(name);
-    };
-    std::map<std::string, std::vector<std::string>>::const_iterator begin()
-        const {
-        return headers_.begin();
-    };
-    std::map<std::string, std::vector<std::string>>::const_iterator end()
-        const {
-        return headers_.end();
+    ~HttpHeaders() { clear(); };
+
+    HttpHeaders(const HttpHeaders&) = delete;
+    HttpHeaders& operator=(const HttpHeaders&) = delete;
+
+    HttpHeaders(HttpHeaders&& other)
+        : headers_(std::move(other.headers_)), resource_(other.resource_){};
+
+    HttpHeaders& operator=(HttpHeaders&& other) {
+        clear();
+        headers_ = std::move(other.headers_);
+        resource_ = other.resource_;
+        return *this;
     };
 
+    // Copies the name and the value.
+    void add(std::string_view name, std::string_view value);
+    void add(HttpHeaderId id, std::string_view value);
+
+    // Keeps the name and the value without copying, they must outlive the
+    // headers.
+    void addView(std::string_view name, std::string_view value);
+
+    // Returns the first value of the header.
+    std::optional<std::string_view> get(HttpHeaderId id) const;
+    std::optional<std::string_view> get(std::string_view name) const;
+
+    size_t count(HttpHeaderId id) const;
+    size_t count(std::string_view name) const;
+
+    void clear();
+
+    const Header* begin() const { return headers_.begin(); };
+    const Header* end() const { return headers_.end(); };
+
    private:
-    std::map<std::string, std::vector<std::string>> headers_;
+    static constexpr size_t kInlineHeadersCount = 16;
+
+    void add(HttpHeaderId id, uint32_t hash, std::string_view name,
+             std::string_view value, bool is_owned);
+
+    std::string_view store(std::string_view data);
+
+    void release(std::string_view data);
+
+    // Finds the first header with the id, or with the name for kOther.
+    const Header* find(HttpHeaderId id, uint32_t hash,
+                       std::string_view name) const;
+
+    SmallVector<Header, kInlineHeadersCount> headers_;
+    std::pmr::memory_resource* resource_;
 };
 
 };  // namespace simple_http
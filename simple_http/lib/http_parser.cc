@@ -4,9 +4,12 @@
 
 #include "http_parser.h"
 
+#include <cassert>
 #include <optional>
 #include <string_view>
-#include <unordered_set>
+
+#include "byte_scanner.h"
+#include "char_classes.h"
 
 namespace simple_http {
 
@@ -14,242 +17,295 @@ static constexpr char kSP = ' ';
 
 static constexpr char kHT = '\t';
 
-static const std::unordered_set<char> kTspecials{
-    '(', ')', '<', '>', '@', ',', ';', ':', '\\', '"',
-    '/', '[', ']', '?', '=', '{', '}', kSP, kHT};
-
-static bool IsChar(char symbol) { return symbol >= 0 && symbol <= 127; }
-
-static bool IsDigit(char symbol) { return symbol >= '0' && symbol <= '9'; }
-
-static bool IsCTL(char symbol) {
-    return (symbol >= 0 && symbol <= 31) || symbol == 127;
-}
-
-static bool IsTspecials(char symbol) {
-    return kTspecials.find(symbol) != kTspecials.end();
-}
-
-std::optional<HttpParser::RequestLine> HttpParser::parseRequestLine(
-    const std::string_view& line, HttpParser::ParseRequestLineError& error) {
-    RequestLine request_line;
-    State state;
-
-    auto method = parseMethod(line, state);
-    if (!method.has_value()) {
-        error = ParseRequestLineError::kMalformedMethod;
-        return std::nullopt;
-    }
-    request_line.method = method.value();
-
-    if (!parseSymbol(kSP, line, state)) {
-        error = ParseRequestLineError::kMalformedLine;
-        return std::nullopt;
-    }
-    skipSpaces(line, state);
-
-    auto uri = parseUri(line, state);
-    if (!uri.has_value()) {
-        error = ParseRequestLineError::kMalformedUri;
-        return std::nullopt;
-    }
-    request_line.uri = uri.value();
-
-    if (state.index == line.length()) {
-        request_line.version = std::nullopt;
-        error = ParseRequestLineError::kOk;
-        return request_line;
-    }
-
-    if (!parseSymbol(kSP, line, state)) {
-        error = ParseRequestLineError::kMalformedLine;
-        return std::nullopt;
-    }
-    skipSpaces(line, state);
-
-    auto version = parseVersion(line, state);
-    if (!version.has_value()) {
-        error = ParseRequestLineError::kMalformedVersion;
-        return std::nullopt;
-    }
-    request_line.version = version.value();
-
-    skipSpaces(line, state);
-    if (state.index != line.length()) {
-        error = ParseRequestLineError::kMalformedLine;
-        return std::nullopt;
-    }
-
-    error = ParseRequestLineError::kOk;
-    return request_line;
-}
-
-std::optional<HttpParser::RequestHeader> HttpParser::parseRequestHeader(
-    const std::string_view& line, ParseRequestHeaderError& error) {
-    State state;
-
-    auto header_name = parseHeaderName(line, state);
-    if (!header_name.has_value()) {
-        error = ParseRequestHeaderError::kMalformedName;
-        return std::nullopt;
-    }
-
-    if (!parseSymbol(':', line, state)) {
-        error = ParseRequestHeaderError::kMalformedLine;
-        return std::nullopt;
-    }
-    skipWhiteSpaces(line, state);
-
-    auto header_value = parseHeaderValue(line, state);
-    if (!header_value.has_value()) {
-        error = ParseRequestHeaderError::kMalformedValue;
-        return std::nullopt;
-    }
-
-    if (state.index != line.length()) {
-        error = ParseRequestHeaderError::kMalformedLine;
-        return std::nullopt;
-    }
-
-    error = ParseRequestHeaderError::kOk;
-    RequestHeader header;
-    header.name = header_name.value();
-    header.value = header_value.value();
-    return header;
-}
-
-std::optional<std::string_view> HttpParser::parseMethod(
-    const std::string_view& line, State& state) {
-    return parseToken(line, state);
-}
-
-std::optional<std::string_view> HttpParser::parseUri(
-    const std::string_view& line, State& state) {
-    size_t start = state.index;
+static constexpr char kCR = '\r';
 
-    if (!parseSymbol('/', line, state) &&
-        !parseLiteral("http://", line, state)) {
-        return std::nullopt;
-    }
-
-    while (state.index < line.length() && line[state.index] != kSP) {
-        state.index++;
-    }
-
-    return std::string_view(line.data() + start, state.index - start);
-}
-
-std::optional<HttpParser::RequestVersion> HttpParser::parseVersion(
-    const std::string_view& line, State& state) {
-    RequestVersion version;
-
-    if (!parseLiteral("HTTP/", line, state)) {
-        return std::nullopt;
-    }
-
-    auto major = parseNumber(line, state);
-    if (!major.has_value()) {
-        state.is_malformed = true;
-        return std::nullopt;
-    }
-    version.major = major.value();
-
-    if (!parseSymbol('.', line, state)) {
-        state.is_malformed = true;
-        return std::nullopt;
-    }
-
-    auto minor = parseNumber(line, state);
-    if (!minor.has_value()) {
-        state.is_malformed = true;
-        return std::nullopt;
-    }
-    version.minor = minor.value();
-
-    return version;
-}
-
-std::optional<std::string_view> HttpParser::parseNumber(
-    const std::string_view& line, State& state) {
-    size_t start = state.index;
-    size_t index = state.index;
-    size_t first_non_zero = -1;
-    while (index < line.length() && IsDigit(line[index])) {
-        if (line[index] != '0' && first_non_zero == -1) {
-            first_non_zero = index;
-        }
-
-        index++;
-    }
+static constexpr char kLF = '\n';
 
-    state.index = index;
+static constexpr std::string_view kHttpScheme = "http://";
 
-    if (index == start) {
-        return std::nullopt;
-    }
+static constexpr std::string_view kHttpName = "http/";
 
-    if (first_non_zero == -1) {
-        size_t last = index - 1;
-        return std::string_view(line.data() + last, 1);
+// Drops leading zeros, keeping the last digit.
+static std::string_view MakeNumber(const char* buffer, size_t start,
+                                   size_t end) {
+    while (end - start > 1 && buffer[start] == '0') {
+        start++;
     }
 
-    return std::string_view(line.data() + first_non_zero,
-                            index - first_non_zero);
+    return std::string_view(buffer + start, end - start);
 }
 
-std::optional<std::string_view> HttpParser::parseHeaderName(
-    const std::string_view& line, State& state) {
-    return parseToken(line, state);
-}
-
-std::optional<std::string_view> HttpParser::parseHeaderValue(
-    const std::string_view& line, State& state) {
-    size_t start = state.index;
-    size_t last_non_empty = -1;
-    while (state.index < line.length()) {
-        if (line[state.index] != kSP && line[state.index] != kHT) {
-            last_non_empty = state.index;
+HttpParser::ParseResult HttpParser::parse(const char* buffer, size_t length,
+                                          ParseError& error) {
+    assert(state_ != State::kDone);
+
+    error = ParseError::kOk;
+    while (index_ < length) {
+        char symbol = buffer[index_];
+        switch (state_) {
+            case State::kMethod:
+                while (index_ < length &&
+                       IsCharClass(buffer[index_], kTokenChar)) {
+                    index_++;
+                }
+
+                if (index_ == length) {
+                    break;
+                }
+
+                if (index_ == line_start_) {
+                    error = ParseError::kMalformedMethod;
+                    return ParseResult::kIncomplete;
+                }
+
+                if (buffer[index_] != kSP) {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                method_end_ = index_;
+                index_++;
+                state_ = State::kSpacesBeforeUri;
+                break;
+            case State::kSpacesBeforeUri:
+                if (symbol == kSP) {
+                    index_++;
+                    break;
+                }
+
+                uri_start_ = index_;
+                if (symbol == '/') {
+                    state_ = State::kUri;
+                } else if (ToLowerAscii(symbol) == kHttpScheme[0]) {
+                    literal_index_ = 1;
+                    state_ = State::kUriScheme;
+                } else {
+                    error = ParseError::kMalformedUri;
+                    return ParseResult::kIncomplete;
+                }
+
+                index_++;
+                break;
+            case State::kUriScheme:
+                if (ToLowerAscii(symbol) != kHttpScheme[literal_index_]) {
+                    error = ParseError::kMalformedUri;
+                    return ParseResult::kIncomplete;
+                }
+
+                index_++;
+                literal_index_++;
+                if (literal_index_ == kHttpScheme.length()) {
+                    state_ = State::kUri;
+                }
+                break;
+            case State::kUri:
+                // Characters of the URI are checked by HttpUriParser.
+                index_ += FindFirstOf(buffer + index_, length - index_, kSP,
+                                      kCR);
+                if (index_ == length) {
+                    break;
+                }
+
+                uri_end_ = index_;
+                if (buffer[index_] == kSP) {
+                    state_ = State::kSpacesBeforeVersion;
+                } else {
+                    has_version_ = false;
+                    state_ = State::kRequestLineEnd;
+                }
+
+                index_++;
+                break;
+            case State::kSpacesBeforeVersion:
+                if (symbol == kSP) {
+                    index_++;
+                    break;
+                }
+
+                literal_index_ = 0;
+                state_ = State::kVersionName;
+                break;
+            case State::kVersionName:
+                if (ToLowerAscii(symbol) != kHttpName[literal_index_]) {
+                    error = ParseError::kMalformedVersion;
+                    return ParseResult::kIncomplete;
+                }
+
+                index_++;
+                literal_index_++;
+                if (literal_index_ == kHttpName.length()) {
+                    major_start_ = index_;
+                    state_ = State::kMajorVersion;
+                }
+                break;
+            case State::kMajorVersion:
+                if (IsCharClass(symbol, kDigit)) {
+                    index_++;
+                    break;
+                }
+
+                if (index_ == major_start_ || symbol != '.') {
+                    error = ParseError::kMalformedVersion;
+                    return ParseResult::kIncomplete;
+                }
+
+                major_end_ = index_;
+                index_++;
+                minor_start_ = index_;
+                state_ = State::kMinorVersion;
+                break;
+            case State::kMinorVersion:
+                if (IsCharClass(symbol, kDigit)) {
+                    index_++;
+                    break;
+                }
+
+                if (index_ == minor_start_) {
+                    error = ParseError::kMalformedVersion;
+                    return ParseResult::kIncomplete;
+                }
+
+                minor_end_ = index_;
+                has_version_ = true;
+                state_ = State::kSpacesAfterVersion;
+                break;
+            case State::kSpacesAfterVersion:
+                if (symbol == kSP) {
+                    index_++;
+                    break;
+                }
+
+                if (symbol != kCR) {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                index_++;
+                state_ = State::kRequestLineEnd;
+                break;
+            case State::kRequestLineEnd:
+                if (symbol != kLF) {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                request_line_.method = std::string_view(
+                    buffer + line_start_, method_end_ - line_start_);
+                request_line_.uri = std::string_view(buffer + uri_start_,
+                                                     uri_end_ - uri_start_);
+                if (has_version_) {
+                    RequestVersion version;
+                    version.major =
+                        MakeNumber(buffer, major_start_, major_end_);
+                    version.minor =
+                        MakeNumber(buffer, minor_start_, minor_end_);
+                    request_line_.version = version;
+                    state_ = State::kHeaderStart;
+                } else {
+                    request_line_.version = std::nullopt;
+                    state_ = State::kDone;
+                }
+
+                index_++;
+                line_start_ = index_;
+                return ParseResult::kRequestLine;
+            case State::kHeaderStart:
+                if (symbol == kCR) {
+                    index_++;
+                    state_ = State::kHeadersEnd;
+                    break;
+                }
+
+                name_start_ = index_;
+                state_ = State::kHeaderName;
+                break;
+            case State::kHeaderName:
+                while (index_ < length &&
+                       IsCharClass(buffer[index_], kTokenChar)) {
+                    index_++;
+                }
+
+                if (index_ == length) {
+                    break;
+                }
+
+                if (index_ == name_start_) {
+                    error = ParseError::kMalformedName;
+                    return ParseResult::kIncomplete;
+                }
+
+                if (buffer[index_] != ':') {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                name_end_ = index_;
+                index_++;
+                state_ = State::kSpacesBeforeValue;
+                break;
+            case State::kSpacesBeforeValue:
+                if (symbol == kSP || symbol == kHT) {
+                    index_++;
+                    break;
+                }
+
+                value_start_ = index_;
+                state_ = State::kHeaderValue;
+                break;
+            case State::kHeaderValue:
+                index_ += FindFirstOf(buffer + index_, length - index_, kCR,
+                                      kLF);
+                if (index_ == length) {
+                    break;
+                }
+
+                if (buffer[index_] == kLF) {
+                    error = ParseError::kMalformedValue;
+                    return ParseResult::kIncomplete;
+                }
+
+                value_end_ = index_;
+                while (value_end_ > value_start_ &&
+                       (buffer[value_end_ - 1] == kSP ||
+                        buffer[value_end_ - 1] == kHT)) {
+                    value_end_--;
+                }
+
+                index_++;
+                state_ = State::kHeaderLineEnd;
+                break;
+            case State::kHeaderLineEnd:
+                if (symbol != kLF) {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                header_.name = std::string_view(buffer + name_start_,
+                                                name_end_ - name_start_);
+                header_.value = std::string_view(buffer + value_start_,
+                                                 value_end_ - value_start_);
+                index_++;
+                line_start_ = index_;
+                state_ = State::kHeaderStart;
+                return ParseResult::kHeader;
+            case State::kHeadersEnd:
+                if (symbol != kLF) {
+                    error = ParseError::kMalformedLine;
+                    return ParseResult::kIncomplete;
+                }
+
+                index_++;
+                line_start_ = index_;
+                state_ = State::kDone;
+                return ParseResult::kHeadersEnd;
+            case State::kDone:
+                return ParseResult::kIncomplete;
         }
-
-        state.index++;
     }
 
-    if (last_non_empty == -1) {
-        return std::string_view(line.data() + start, 0);
-    }
-
-    return std::string_view(line.data() + start, (last_non_empty + 1) - start);
+    return ParseResult::kIncomplete;
 }
 
-std::optional<std::string_view> HttpParser::parseToken(
-    const std::string_view& line, State& state) {
-    size_t start = state.index;
-    size_t index = state.index;
-    while (index < line.length() && IsChar(line[index]) &&
-           !IsCTL(line[index]) && !IsTspecials(line[index])) {
-        index++;
-    }
-
-    state.index = index;
-
-    if (index == start) {
-        return std::nullopt;
-    }
-
-    return std::string_view(line.data() + start, index - start);
-}
-
-void HttpParser::skipSpaces(const std::string_view& line, State& state) {
-    while (state.index < line.length() && line[state.index] == kSP) {
-        state.index++;
-    }
-}
-
-void HttpParser::skipWhiteSpaces(const std::string_view& line, State& state) {
-    while (state.index < line.length() &&
-           (line[state.index] == kSP || line[state.index] == kHT)) {
-        state.index++;
-    }
-}
+void HttpParser::reset() { *this = HttpParser(); }
 
 }  // namespace simple_http
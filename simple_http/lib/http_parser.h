@@ -7,11 +7,11 @@
 #include <optional>
 #include <string_view>
 
-#include "base_parser.h"
-
 namespace simple_http {
 
-class HttpParser : private BaseParser {
+// Parses a request head byte by byte. It stops when the buffer runs out and
+// resumes from the same byte when called again with more data.
+class HttpParser {
    public:
     struct RequestVersion {
         std::string_view major;
@@ -24,57 +24,89 @@ class HttpParser : private BaseParser {
         std::optional<RequestVersion> version;
     };
 
-    enum class ParseRequestLineError {
-        kOk = 0,
-        kMalformedMethod = 1,
-        kMalformedUri = 2,
-        kMalformedVersion = 3,
-        kMalformedLine = 4,
-    };
-
     struct RequestHeader {
         std::string_view name;
         std::string_view value;
     };
 
-    enum class ParseRequestHeaderError {
+    enum class ParseResult {
+        // More data is needed.
+        kIncomplete = 0,
+        kRequestLine = 1,
+        kHeader = 2,
+        // The empty line after the headers.
+        kHeadersEnd = 3,
+    };
+
+    enum class ParseError {
         kOk = 0,
-        kMalformedName = 1,
-        kMalformedValue = 2,
+        kMalformedMethod = 1,
+        kMalformedUri = 2,
+        kMalformedVersion = 3,
         kMalformedLine = 4,
+        kMalformedName = 5,
+        kMalformedValue = 6,
     };
 
-    std::optional<RequestLine> parseRequestLine(const std::string_view& line,
-                                                ParseRequestLineError& error);
-
-    std::optional<RequestHeader> parseRequestHeader(
-        const std::string_view& line, ParseRequestHeaderError& error);
-
-   private:
-    std::optional<std::string_view> parseMethod(const std::string_view& line,
-                                                State& state);
-
-    std::optional<std::string_view> parseUri(const std::string_view& line,
-                                             State& state);
-
-    std::optional<RequestVersion> parseVersion(const std::string_view& line,
-                                               State& state);
+    // Continues parsing where the previous call stopped. The buffer must hold
+    // the same bytes as before, possibly followed by new ones. Returns after
+    // each parsed line, whose parts point into the buffer.
+    ParseResult parse(const char* buffer, size_t length, ParseError& error);
 
-    std::optional<std::string_view> parseNumber(const std::string_view& line,
-                                                State& state);
+    // Valid after kRequestLine until the buffer changes.
+    const RequestLine& getRequestLine() const { return request_line_; };
 
-    std::optional<std::string_view> parseHeaderName(
-        const std::string_view& line, State& state);
+    // Valid after kHeader until the buffer changes.
+    const RequestHeader& getHeader() const { return header_; };
 
-    std::optional<std::string_view> parseHeaderValue(
-        const std::string_view& line, State& state);
+    // Bytes of the request head parsed so far.
+    size_t getParsedBytes() const { return index_; };
 
-    std::optional<std::string_view> parseToken(const std::string_view& line,
-                                               State& state);
+    void reset();
 
-    void skipSpaces(const std::string_view& line, State& state);
+   private:
+    enum class State {
+        kMethod,
+        kSpacesBeforeUri,
+        kUriScheme,
+        kUri,
+        kSpacesBeforeVersion,
+        kVersionName,
+        kMajorVersion,
+        kMinorVersion,
+        kSpacesAfterVersion,
+        kRequestLineEnd,
+        kHeaderStart,
+        kHeaderName,
+        kSpacesBeforeValue,
+        kHeaderValue,
+        kHeaderLineEnd,
+        kHeadersEnd,
+        kDone,
+    };
 
-    void skipWhiteSpaces(const std::string_view& line, State& state);
+    State state_ = State::kMethod;
+    size_t index_ = 0;
+    size_t line_start_ = 0;
+    // Matched bytes of "http://" or "HTTP/".
+    size_t literal_index_ = 0;
+
+    size_t method_end_ = 0;
+    size_t uri_start_ = 0;
+    size_t uri_end_ = 0;
+    size_t major_start_ = 0;
+    size_t major_end_ = 0;
+    size_t minor_start_ = 0;
+    size_t minor_end_ = 0;
+    bool has_version_ = false;
+
+    size_t name_start_ = 0;
+    size_t name_end_ = 0;
+    size_t value_start_ = 0;
+    size_t value_end_ = 0;
+
+    RequestLine request_line_;
+    RequestHeader header_;
 };
 
 }  // namespace simple_http
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "http_headers.h"
 #include "http_method.h"
@@ -14,16 +15,25 @@
 
 namespace simple_http {
 
+// Views point into the request head, which stays in the input buffer of the
+// connection until the response ends.
 struct HttpRequestData {
-    HttpMethod method;
-    std::string method_name;
-    std::string href;
-    std::string path;
-    std::string query;
-    HttpVersion http_version;
+    HttpMethod method = HttpMethod::kNone;
+    std::string_view method_name;
+    // Upper-cased name of a custom method.
+    std::string custom_method_name;
+    std::string_view href;
+    std::string_view path;
+    std::string_view query;
+    HttpVersion http_version = HttpVersion::kNone;
     HttpHeaders headers;
-    size_t content_length;
-    std::unique_ptr<MessageBody> body;
+    size_t content_length = 0;
+    // Owned by the connection.
+    MessageBody* body = nullptr;
+    // Whether the connection may be reused after the response. Computed from
+    // the request version and the Connection header, may be overridden by
+    // the response.
+    bool keep_alive = false;
 };
 
 }  // namespace simple_http
@@ -4,18 +4,114 @@
 
 #include "http_server.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <iterator>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include "event_loop.h"
 #include "http_connection.h"
 #include "http_connection_handler.h"
 #include "init_library.h"
 #include "server.h"
 #include "socket.h"
 #include "thread_pool.h"
+#include "timer_wheel.h"
 
 namespace simple_http {
 
+// Sent when a client does not finish its request head in time. The version
+// of the request may be unknown yet.
+static constexpr char kRequestTimeoutResponse[] =
+    "HTTP/1.1 408 Request Timeout\r\nConnection: close\r\n\r\n";
+
+static HttpConnection::Options MakeConnectionOptions(
+    const HttpServer::Options& options) {
+    HttpConnection::Options connection_options;
+    connection_options.max_requests = options.keep_alive_max_requests;
+    connection_options.keep_alive_timeout = options.keep_alive_timeout;
+    connection_options.header_timeout = options.header_timeout;
+    connection_options.min_body_rate = options.min_body_rate;
+    return connection_options;
+}
+
+static std::string MakeOverloadResponse(std::chrono::seconds retry_after) {
+    std::string response = "HTTP/1.1 503 Service Unavailable\r\n";
+    response += "Retry-After: " + std::to_string(retry_after.count()) + "\r\n";
+    response += "Content-Length: 0\r\n";
+    response += "Connection: close\r\n\r\n";
+    return response;
+}
+
+// Decides whether a new connection is served.
+struct AdmissionLimits {
+    size_t max_connections = 0;
+    bool is_queue_full = false;
+    std::string_view overload_response;
+};
+
+static AdmissionLimits MakeAdmissionLimits(
+    const HttpServer::Options& options, std::string_view overload_response,
+    size_t planned_tasks_count) {
+    AdmissionLimits limits;
+    limits.max_connections = options.max_connections;
+    limits.is_queue_full = options.max_planned_tasks != 0 &&
+                           planned_tasks_count >= options.max_planned_tasks;
+    limits.overload_response = overload_response;
+    return limits;
+}
+
+static bool IsAdmitted(const AdmissionLimits& limits,
+                       size_t connections_count) {
+    if (limits.is_queue_full) {
+        return false;
+    }
+
+    return limits.max_connections == 0 ||
+           connections_count < limits.max_connections;
+}
+
+// Reads made to drain the request of a rejected connection.
+constexpr size_t kRejectDrainReadsCount = 4;
+
+// Answers with the overload response and closes the connection without
+// waiting for the client, the accepting thread must not block on it.
+// Closing a socket with unread data resets the connection, which can
+// discard the response before the client reads it. So the write side is
+// shut down first, and the request bytes already received are drained.
+static void RejectConnection(SocketDescriptor client_socket_descriptor,
+                             std::string_view overload_response) {
+    Socket client_socket(client_socket_descriptor);
+    if (client_socket.setNonBlocking() != Socket::SetNonBlockingError::kOk) {
+        return;
+    }
+
+    Socket::SendError send_error;
+    client_socket.trySend(overload_response.data(), overload_response.length(),
+                          send_error);
+    if (send_error != Socket::SendError::kOk ||
+        client_socket.shutdownWrite() != Socket::ShutdownError::kOk) {
+        return;
+    }
+
+    char buffer[4096];
+    for (size_t i = 0; i < kRejectDrainReadsCount; i++) {
+        Socket::ReadError read_error;
+        size_t bytes_count =
+            client_socket.read(buffer, sizeof(buffer), read_error);
+        if (read_error != Socket::ReadError::kOk || bytes_count == 0) {
+            break;
+        }
+    }
+}
+
 HttpServer::~HttpServer() {
     if (should_cleanup_library_) {
         CleanupLibrary();
@@ -33,6 +129,15 @@ std::unique_ptr<HttpServer> HttpServer::create(HttpServer::Options options,
     assert(options.timeout.count() >= 0);
     assert(options.request_buffer_length >= 1024);
     assert(options.response_buffer_length >= 1024);
+    assert(options.keep_alive_max_requests >= 1);
+    assert(options.keep_alive_timeout.count() >= 0);
+    assert(options.overload_retry_after.count() >= 0);
+    assert(options.queue_budget.count() > 0);
+
+    if (options.io_backend == IoBackend::kIoUring &&
+        !EventLoop::isSupported(EventLoop::Backend::kIoUring)) {
+        options.io_backend = IoBackend::kSyscalls;
+    }
 
     bool should_cleanup_library = false;
     if (!IsLibraryInitialized()) {
@@ -47,6 +152,8 @@ std::unique_ptr<HttpServer> HttpServer::create(HttpServer::Options options,
     std::unique_ptr<HttpServer> server =
         std::unique_ptr<HttpServer>(new HttpServer(options, handler));
     server->should_cleanup_library_ = should_cleanup_library;
+    server->overload_response_ =
+        MakeOverloadResponse(options.overload_retry_after);
     error = CreateError::kOk;
     return server;
 }
@@ -61,28 +168,59 @@ HttpServer::ListenError HttpServer::listen(int port, std::string hostname) {
 
 HttpServer::ListenError HttpServer::listen(int port, std::string hostname,
                                            size_t backlog) {
+    if (options_.connection_model == ConnectionModel::kReusePort) {
+        return serveWithReusePort(port, hostname, backlog);
+    }
+
+    ListenError error;
+    auto tcp_server = createListener(port, hostname, backlog, false, error);
+    if (error != ListenError::kOk) {
+        return error;
+    }
+
+    switch (options_.connection_model) {
+        case ConnectionModel::kEventLoop:
+            return serveWithEventLoop(*tcp_server);
+        default:
+            return serveBlocking(*tcp_server);
+    }
+}
+
+std::unique_ptr<Server> HttpServer::createListener(
+    int port, const std::string& hostname, size_t backlog, bool reuse_port,
+    HttpServer::ListenError& error) {
     Server::CreateError create_error;
     auto tcp_server = Server::createServer(create_error);
     if (create_error != Server::CreateError::kOk) {
-        return HttpServer::ListenError::kUnknown;
+        error = ListenError::kUnknown;
+        return nullptr;
     }
 
     Server::BindOptions bind_options;
     bind_options.port = port;
     bind_options.address = hostname;
+    bind_options.reuse_port = reuse_port;
     Server::BindError bind_error;
     bind_error = tcp_server->bind(bind_options);
     if (bind_error != Server::BindError::kOk) {
         switch (bind_error) {
             case Server::BindError::kWrongAddress:
-                return ListenError::kWrongAddress;
+                error = ListenError::kWrongAddress;
+                break;
             case Server::BindError::kAddressInUse:
-                return ListenError::kAddressInUse;
+                error = ListenError::kAddressInUse;
+                break;
             case Server::BindError::kNoAccess:
-                return ListenError::kNoAccess;
+                error = ListenError::kNoAccess;
+                break;
+            case Server::BindError::kNotSupported:
+                error = ListenError::kNotSupported;
+                break;
             default:
-                return ListenError::kUnknown;
+                error = ListenError::kUnknown;
+                break;
         }
+        return nullptr;
     }
 
     Server::ListenOptions listen_options;
@@ -90,24 +228,54 @@ HttpServer::ListenError HttpServer::listen(int port, std::string hostname,
     Server::ListenError listen_error;
     listen_error = tcp_server->listen(listen_options);
     if (listen_error != Server::ListenError::kOk) {
-        return ListenError::kUnknown;
+        error = ListenError::kUnknown;
+        return nullptr;
     }
 
-    auto thread_pool = ThreadPool<ThreadState>::create(
-        options_.threads_count, [this](size_t index) {
-            auto state = std::make_unique<ThreadState>();
-            state->request_buffer.resize(options_.request_buffer_length);
-            state->response_buffer.resize(options_.request_buffer_length);
-            return state;
-        });
+    error = ListenError::kOk;
+    return tcp_server;
+}
+
+std::unique_ptr<ThreadPool<HttpServer::ThreadState>>
+HttpServer::createThreadPool() {
+    ThreadPoolOptions pool_options;
+    pool_options.scheduling = options_.scheduling == Scheduling::kWorkStealing
+                                  ? ThreadPoolScheduling::kWorkStealing
+                                  : ThreadPoolScheduling::kSharedQueue;
+    pool_options.discipline =
+        options_.queue_discipline == QueueDiscipline::kCoDel
+            ? ThreadPoolDiscipline::kCoDel
+            : ThreadPoolDiscipline::kFifo;
+    pool_options.codel.target = options_.queue_target;
+    pool_options.codel.interval = options_.queue_interval;
+    pool_options.codel.budget = options_.queue_budget;
+    return ThreadPool<ThreadState>::create(
+        options_.threads_count,
+        [this](size_t) { return createThreadState(); }, pool_options);
+}
+
+std::unique_ptr<HttpServer::ThreadState> HttpServer::createThreadState() {
+    auto state = std::make_unique<ThreadState>();
+    state->request_buffer.resize(options_.request_buffer_length);
+    state->response_buffer.resize(options_.response_buffer_length);
+    return state;
+}
+
+HttpServer::ListenError HttpServer::serveBlocking(Server& tcp_server) {
+    auto thread_pool = createThreadPool();
     if (thread_pool == nullptr) {
         return ListenError::kPoolCreation;
     }
 
+    HttpConnection::Options connection_options =
+        MakeConnectionOptions(options_);
+
+    // Only the descriptor is posted, the socket lives on the stack of the
+    // worker, so dispatching a connection does not allocate.
     while (true) {
         simple_http::Server::AcceptError accept_error;
-        std::unique_ptr<simple_http::Socket> client_socket =
-            tcp_server->accept(accept_error);
+        SocketDescriptor client_socket_descriptor =
+            tcp_server.acceptDescriptor(accept_error);
         if (accept_error != simple_http::Server::AcceptError::kOk) {
             if (accept_error == simple_http::Server::AcceptError::kInterrupt) {
                 break;
@@ -116,23 +284,490 @@ HttpServer::ListenError HttpServer::listen(int port, std::string hostname,
             }
         }
 
-        if (options_.timeout.count() > 0) {
-            Socket::SetTimeoutError set_timeout_error;
-            set_timeout_error = client_socket->setTimeout(options_.timeout);
-            if (set_timeout_error != Socket::SetTimeoutError::kOk) {
+        AdmissionLimits limits = MakeAdmissionLimits(
+            options_, overload_response_, thread_pool->getPlannedTasksCount());
+        if (!IsAdmitted(limits, connections_count_.load())) {
+            RejectConnection(client_socket_descriptor, overload_response_);
+            continue;
+        }
+
+        connections_count_.fetch_add(1);
+        thread_pool->post([client_socket_descriptor, connection_options,
+                           this](ThreadState* state, bool is_expired) {
+            // An expired connection is closed without reading the request.
+            Socket client_socket(client_socket_descriptor);
+            bool is_configured = !is_expired;
+            if (is_configured && options_.timeout.count() > 0) {
+                is_configured =
+                    client_socket.setTimeouts(options_.timeout,
+                                              options_.write_timeout) ==
+                    Socket::SetTimeoutError::kOk;
+            }
+
+            if (is_configured) {
+                HttpConnection connection(&client_socket, connection_options,
+                                          state->request_buffer,
+                                          state->response_buffer,
+                                          state->arena);
+                connection.proccessRequests(handler_);
+            }
+
+            connections_count_.fetch_sub(1);
+        });
+    }
+
+    return ListenError::kOk;
+}
+
+struct EventLoopConnection;
+
+typedef std::list<std::unique_ptr<EventLoopConnection>>
+    EventLoopConnectionList;
+
+struct EventLoopConnection {
+    EventLoopConnection(std::unique_ptr<Socket> client_socket,
+                        const HttpConnection::Options& options)
+        : socket(std::move(client_socket)),
+          connection(socket.get(), options),
+          timer(this){};
+
+    std::unique_ptr<Socket> socket;
+    HttpConnection connection;
+    HttpConnection::ProccessRequestError result =
+        HttpConnection::ProccessRequestError::kOk;
+
+    // Data received by the event loop for the next resume().
+    EventLoop::Event received_event;
+
+    // The list owning the connection and the position in it.
+    EventLoopConnectionList* list = nullptr;
+    EventLoopConnectionList::iterator position;
+
+    // Closes the connection when it waits for data for too long.
+    TimerWheel::Timer timer;
+    // The whole head of the current request must arrive by then.
+    std::chrono::steady_clock::time_point head_deadline;
+    // Requests started as of the last wait, a new one gets a new deadline.
+    size_t requests_count = 0;
+};
+
+// Every connection of an event loop is owned by one of the lists. Waiting
+// connections are closed once their timer expires: idle ones wait for the
+// next request, receiving ones for the rest of the current request head.
+// Active connections are being served by workers.
+struct EventLoopConnections {
+    EventLoopConnectionList idle;
+    EventLoopConnectionList receiving;
+    EventLoopConnectionList active;
+    TimerWheel timers;
+};
+
+// time_point::max() for a zero timeout, which means no limit.
+static std::chrono::steady_clock::time_point GetDeadline(
+    std::chrono::milliseconds timeout) {
+    return timeout.count() > 0 ? std::chrono::steady_clock::now() + timeout
+                               : std::chrono::steady_clock::time_point::max();
+}
+
+static void MoveConnection(EventLoopConnection* connection,
+                           EventLoopConnectionList& list) {
+    list.splice(list.end(), *connection->list, connection->position);
+    connection->list = &list;
+}
+
+static void CloseConnection(EventLoop& event_loop,
+                            EventLoopConnection* connection) {
+    event_loop.remove(connection->socket->getDescriptor(), connection);
+    connection->list->erase(connection->position);
+}
+
+static void ScheduleClose(EventLoopConnection* connection, TimerWheel& timers,
+                          std::chrono::steady_clock::time_point deadline) {
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        connection->timer.cancel();
+    } else {
+        timers.schedule(&connection->timer, deadline);
+    }
+}
+
+static void WaitForData(EventLoop& event_loop,
+                        EventLoopConnection* connection,
+                        EventLoopConnectionList& list, TimerWheel& timers,
+                        std::chrono::steady_clock::time_point deadline) {
+    MoveConnection(connection, list);
+    ScheduleClose(connection, timers, deadline);
+
+    EventLoop::WatchError watch_error;
+    watch_error = event_loop.rearm(connection->socket->getDescriptor(),
+                                   connection);
+    if (watch_error != EventLoop::WatchError::kOk) {
+        CloseConnection(event_loop, connection);
+    }
+}
+
+// Workers wait for the body and for sending the response with the socket
+// timeouts, the loop waits for the request head with the timer.
+static void AddConnection(EventLoop& event_loop,
+                          std::unique_ptr<Socket> client_socket,
+                          const HttpConnection::Options& options,
+                          EventLoopConnections& connections,
+                          const HttpServer::Options& server_options) {
+    if (client_socket->setNonBlocking() != Socket::SetNonBlockingError::kOk) {
+        return;
+    }
+    client_socket->setTimeouts(server_options.body_timeout,
+                               server_options.write_timeout);
+
+    EventLoopConnectionList& list = connections.receiving;
+    list.push_back(std::make_unique<EventLoopConnection>(
+        std::move(client_socket), options));
+    EventLoopConnection* connection = list.back().get();
+    connection->list = &list;
+    connection->position = std::prev(list.end());
+    // The first request is timed from the accept.
+    connection->requests_count = 1;
+    connection->head_deadline = GetDeadline(server_options.header_timeout);
+    ScheduleClose(connection, connections.timers, connection->head_deadline);
+
+    EventLoop::WatchError watch_error;
+    watch_error = event_loop.add(connection->socket->getDescriptor(),
+                                 connection);
+    if (watch_error != EventLoop::WatchError::kOk) {
+        CloseConnection(event_loop, connection);
+    }
+}
+
+static size_t CountConnections(const EventLoopConnections& connections) {
+    return connections.idle.size() + connections.receiving.size() +
+           connections.active.size();
+}
+
+static void AdmitConnection(EventLoop& event_loop,
+                            SocketDescriptor client_socket_descriptor,
+                            const HttpConnection::Options& options,
+                            EventLoopConnections& connections,
+                            const HttpServer::Options& server_options,
+                            const AdmissionLimits& limits) {
+    if (!IsAdmitted(limits, CountConnections(connections))) {
+        RejectConnection(client_socket_descriptor, limits.overload_response);
+        return;
+    }
+
+    AddConnection(event_loop,
+                  std::make_unique<Socket>(client_socket_descriptor), options,
+                  connections, server_options);
+}
+
+static void AcceptConnections(EventLoop& event_loop, Server& tcp_server,
+                              const EventLoop::Event& event,
+                              const HttpConnection::Options& options,
+                              EventLoopConnections& connections,
+                              const HttpServer::Options& server_options,
+                              const AdmissionLimits& limits) {
+    if (event.type == EventLoop::Event::Type::kAccepted) {
+        AdmitConnection(event_loop, event.accepted_descriptor, options,
+                        connections, server_options, limits);
+        return;
+    }
+
+    while (true) {
+        Server::AcceptError accept_error;
+        SocketDescriptor client_socket_descriptor =
+            tcp_server.acceptDescriptor(accept_error);
+        if (accept_error != Server::AcceptError::kOk) {
+            break;
+        }
+
+        AdmitConnection(event_loop, client_socket_descriptor, options,
+                        connections, server_options, limits);
+    }
+
+    event_loop.rearmListener(tcp_server.getDescriptor(), &tcp_server);
+}
+
+static void ResumeConnection(EventLoopConnection* connection,
+                             std::vector<char>& request_buffer,
+                             std::vector<char>& response_buffer,
+                             RequestArena& arena,
+                             const HttpConnectionHandler& handler) {
+    const EventLoop::Event& received = connection->received_event;
+    connection->connection.attachBuffers(request_buffer, response_buffer,
+                                         arena);
+    if (received.type == EventLoop::Event::Type::kReceived) {
+        connection->connection.setReceivedData(received.received_data,
+                                               received.received_length);
+    }
+    connection->result = connection->connection.resume(handler);
+    connection->connection.detachBuffers();
+}
+
+// Closes a resumed connection or makes it wait for more data.
+static void CompleteConnection(EventLoop& event_loop,
+                               EventLoopConnection* connection,
+                               EventLoopConnections& connections,
+                               const HttpServer::Options& options) {
+    event_loop.releaseBuffer(connection->received_event);
+    connection->received_event = EventLoop::Event();
+
+    if (connection->result !=
+            HttpConnection::ProccessRequestError::kWouldBlock ||
+        connection->socket->isClosed()) {
+        CloseConnection(event_loop, connection);
+    } else if (connection->connection.isIdle()) {
+        WaitForData(event_loop, connection, connections.idle,
+                    connections.timers,
+                    GetDeadline(options.keep_alive_timeout));
+    } else {
+        size_t requests_count = connection->connection.getRequestsCount();
+        if (requests_count != connection->requests_count) {
+            connection->requests_count = requests_count;
+            connection->head_deadline = GetDeadline(options.header_timeout);
+        }
+
+        WaitForData(event_loop, connection, connections.receiving,
+                    connections.timers, connection->head_deadline);
+    }
+}
+
+static void CloseExpiredConnections(EventLoop& event_loop,
+                                    EventLoopConnections& connections) {
+    connections.timers.advance(std::chrono::steady_clock::now());
+    while (TimerWheel::Timer* timer = connections.timers.takeExpired()) {
+        auto connection = static_cast<EventLoopConnection*>(timer->getData());
+        // A client stuck in the middle of a request head learns why it is
+        // closed, without the loop waiting for it.
+        if (!connection->connection.isIdle()) {
+            Socket::SendError send_error;
+            connection->socket->trySend(kRequestTimeoutResponse,
+                                        sizeof(kRequestTimeoutResponse) - 1,
+                                        send_error);
+        }
+        CloseConnection(event_loop, connection);
+    }
+}
+
+static std::chrono::milliseconds GetWaitTimeout(
+    const EventLoopConnections& connections) {
+    using namespace std::chrono;
+
+    steady_clock::time_point deadline = connections.timers.getNextDeadline();
+
+    if (deadline == steady_clock::time_point::max()) {
+        return milliseconds(-1);
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    if (deadline <= now) {
+        return milliseconds(0);
+    }
+
+    return ceil<milliseconds>(deadline - now);
+}
+
+std::unique_ptr<EventLoop> HttpServer::createEventLoop(
+    Server& tcp_server, HttpServer::ListenError& error) {
+    EventLoop::Backend backend = options_.io_backend == IoBackend::kIoUring
+                                     ? EventLoop::Backend::kIoUring
+                                     : EventLoop::Backend::kEpoll;
+    EventLoop::CreateError create_error;
+    auto event_loop = EventLoop::create(backend, create_error);
+    if (create_error != EventLoop::CreateError::kOk) {
+        error = ListenError::kEventLoopCreation;
+        return nullptr;
+    }
+
+    if (tcp_server.setNonBlocking() != Server::SetNonBlockingError::kOk ||
+        event_loop->addListener(tcp_server.getDescriptor(), &tcp_server) !=
+            EventLoop::WatchError::kOk) {
+        error = ListenError::kUnknown;
+        return nullptr;
+    }
+
+    error = ListenError::kOk;
+    return event_loop;
+}
+
+HttpServer::ListenError HttpServer::serveWithEventLoop(Server& tcp_server) {
+    constexpr size_t kMaxEvents = 256;
+
+    ListenError error;
+    auto event_loop = createEventLoop(tcp_server, error);
+    if (error != ListenError::kOk) {
+        return error;
+    }
+
+    HttpConnection::Options connection_options =
+        MakeConnectionOptions(options_);
+
+    EventLoopConnections connections;
+
+    // Workers hand served connections back to the loop thread, which is
+    // the only one touching the lists.
+    std::mutex completed_mutex;
+    std::vector<EventLoopConnection*> completed_connections;
+    std::vector<EventLoopConnection*> completed_batch;
+
+    auto thread_pool = createThreadPool();
+    if (thread_pool == nullptr) {
+        return ListenError::kPoolCreation;
+    }
+
+    EventLoop::Event events[kMaxEvents];
+    while (true) {
+        EventLoop::WaitError wait_error;
+        size_t events_count = event_loop->wait(
+            events, kMaxEvents, GetWaitTimeout(connections), wait_error);
+        if (wait_error == EventLoop::WaitError::kInterrupt) {
+            break;
+        }
+
+        for (size_t i = 0; i < events_count; i++) {
+            const EventLoop::Event& event = events[i];
+            if (event.type == EventLoop::Event::Type::kAccepted ||
+                event.type == EventLoop::Event::Type::kAcceptable) {
+                AcceptConnections(
+                    *event_loop, tcp_server, event, connection_options,
+                    connections, options_,
+                    MakeAdmissionLimits(options_, overload_response_,
+                                        thread_pool->getPlannedTasksCount()));
                 continue;
             }
+
+            auto connection = static_cast<EventLoopConnection*>(event.data);
+            connection->received_event = event;
+            connection->timer.cancel();
+            MoveConnection(connection, connections.active);
+            thread_pool->post([connection, &completed_mutex,
+                               &completed_connections, &event_loop,
+                               this](ThreadState* state, bool is_expired) {
+                // The loop thread closes an expired connection.
+                if (is_expired) {
+                    connection->result =
+                        HttpConnection::ProccessRequestError::kConnectionClosed;
+                } else {
+                    ResumeConnection(connection, state->request_buffer,
+                                     state->response_buffer, state->arena,
+                                     handler_);
+                }
+
+                {
+                    std::unique_lock lock(completed_mutex);
+                    completed_connections.push_back(connection);
+                }
+                event_loop->wake();
+            });
         }
 
-        std::shared_ptr<simple_http::Socket> shared_client_socket =
-            std::move(client_socket);
-        thread_pool->post([client_socket = std::move(shared_client_socket),
-                           this](ThreadState* state) {
-            HttpConnection connection(client_socket.get(),
-                                      state->request_buffer,
-                                      state->response_buffer);
-            connection.proccessRequest(handler_);
-        });
+        {
+            std::unique_lock lock(completed_mutex);
+            completed_batch.swap(completed_connections);
+        }
+
+        for (EventLoopConnection* connection : completed_batch) {
+            CompleteConnection(*event_loop, connection, connections,
+                               options_);
+        }
+        completed_batch.clear();
+
+        CloseExpiredConnections(*event_loop, connections);
+    }
+
+    return ListenError::kOk;
+}
+
+HttpServer::ListenError HttpServer::serveWithReusePort(
+    int port, const std::string& hostname, size_t backlog) {
+    if (options_.threads_count == 0) {
+        return ListenError::kPoolCreation;
+    }
+
+    // All listeners are bound before any worker starts, so a busy port is
+    // reported instead of leaving part of the workers running.
+    std::vector<std::unique_ptr<Server>> listeners;
+    for (size_t i = 0; i < options_.threads_count; i++) {
+        ListenError error;
+        auto tcp_server = createListener(port, hostname, backlog, true, error);
+        if (error != ListenError::kOk) {
+            return error;
+        }
+
+        listeners.push_back(std::move(tcp_server));
+    }
+
+    std::vector<ListenError> results(listeners.size(), ListenError::kOk);
+    std::vector<std::thread> workers;
+    try {
+        for (size_t i = 0; i < listeners.size(); i++) {
+            workers.emplace_back([this, &listeners, &results, i] {
+                results[i] = serveLocally(*listeners[i]);
+            });
+        }
+    } catch (...) {
+        // Workers already started serve until they are interrupted.
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        return ListenError::kPoolCreation;
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (ListenError result : results) {
+        if (result != ListenError::kOk) {
+            return result;
+        }
+    }
+
+    return ListenError::kOk;
+}
+
+HttpServer::ListenError HttpServer::serveLocally(Server& tcp_server) {
+    constexpr size_t kMaxEvents = 256;
+
+    ListenError error;
+    auto event_loop = createEventLoop(tcp_server, error);
+    if (error != ListenError::kOk) {
+        return error;
+    }
+
+    std::unique_ptr<ThreadState> state = createThreadState();
+
+    HttpConnection::Options connection_options =
+        MakeConnectionOptions(options_);
+
+    EventLoopConnections connections;
+
+    EventLoop::Event events[kMaxEvents];
+    while (true) {
+        EventLoop::WaitError wait_error;
+        size_t events_count = event_loop->wait(
+            events, kMaxEvents, GetWaitTimeout(connections), wait_error);
+        if (wait_error == EventLoop::WaitError::kInterrupt) {
+            break;
+        }
+
+        for (size_t i = 0; i < events_count; i++) {
+            const EventLoop::Event& event = events[i];
+            if (event.type == EventLoop::Event::Type::kAccepted ||
+                event.type == EventLoop::Event::Type::kAcceptable) {
+                AcceptConnections(
+                    *event_loop, tcp_server, event, connection_options,
+                    connections, options_,
+                    MakeAdmissionLimits(options_, overload_response_, 0));
+                continue;
+            }
+
+            auto connection = static_cast<EventLoopConnection*>(event.data);
+            connection->received_event = event;
+            ResumeConnection(connection, state->request_buffer,
+                             state->response_buffer, state->arena, handler_);
+            CompleteConnection(*event_loop, connection, connections,
+                               options_);
+        }
+
+        CloseExpiredConnections(*event_loop, connections);
     }
 
     return ListenError::kOk;
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <memory>
@@ -12,17 +13,106 @@
 #include <vector>
 
 #include "http_connection_handler.h"
+#include "request_arena.h"
 
 namespace simple_http {
 
+class Server;
+
+class EventLoop;
+
+template <typename ThreadState>
+class ThreadPool;
+
 class HttpServer {
    public:
+    enum class ConnectionModel {
+        // A worker serves one connection at a time with blocking I/O.
+        kBlocking = 0,
+        // Non-blocking connections are multiplexed by an event loop, a
+        // worker runs only when a connection has received data.
+        kEventLoop = 1,
+        // Every worker listens on the port with its own socket
+        // (SO_REUSEPORT) and event loop, then accepts and serves the
+        // connections on its own thread.
+        kReusePort = 2,
+    };
+
+    // How the event loop model talks to the kernel.
+    enum class IoBackend {
+        // Readiness notifications, every read is a system call.
+        kSyscalls = 0,
+        // io_uring: connections are accepted and received by the kernel in
+        // batches. Falls back to kSyscalls where io_uring is not available.
+        kIoUring = 1,
+    };
+
+    // How the thread pool of the blocking and the event loop models hands
+    // tasks to the workers.
+    enum class Scheduling {
+        // One queue shared by all the workers.
+        kSharedQueue = 0,
+        // A queue per worker, idle workers steal tasks from busy ones. Keeps
+        // cheap requests from waiting behind slow ones.
+        kWorkStealing = 1,
+    };
+
+    // The order in which queued tasks are served.
+    enum class QueueDiscipline {
+        // First come, first served.
+        kFifo = 0,
+        // CoDel: while the queue stays above queue_target for
+        // queue_interval, the newest tasks are served first and the ones
+        // waiting over twice the target are closed without being served.
+        // Tasks waiting longer than queue_budget are closed in any case.
+        kCoDel = 1,
+    };
+
     struct Options {
+        // How long the blocking model waits for each part of a request.
         std::chrono::milliseconds timeout = std::chrono::milliseconds(1000);
+        // A connection whose request head does not arrive within it gets
+        // 408 Request Timeout and is closed. It counts from the first byte of
+        // the request, or from the accept for the first one.
+        std::chrono::milliseconds header_timeout =
+            std::chrono::milliseconds(10000);
+        // How long the event loop models wait for each part of a body.
+        std::chrono::milliseconds body_timeout =
+            std::chrono::milliseconds(1000);
+        // Bytes per second a request body must keep up once the first wait
+        // for it (timeout or body_timeout) has passed, a slower one gets
+        // 408 Request Timeout. Zero means no limit.
+        size_t min_body_rate = 1024;
+        // How long a response waits for the client to take each part.
+        std::chrono::milliseconds write_timeout =
+            std::chrono::milliseconds(1000);
         size_t request_buffer_length = 32768;
         size_t response_buffer_length = 32768;
         size_t threads_count =
             static_cast<size_t>(std::thread::hardware_concurrency());
+        // Maximum number of requests served over one persistent connection.
+        size_t keep_alive_max_requests = 100;
+        // How long a persistent connection may stay idle between requests.
+        // Zero closes it unless the next request has already arrived.
+        std::chrono::milliseconds keep_alive_timeout =
+            std::chrono::milliseconds(5000);
+        ConnectionModel connection_model = ConnectionModel::kBlocking;
+        IoBackend io_backend = IoBackend::kSyscalls;
+        Scheduling scheduling = Scheduling::kSharedQueue;
+        QueueDiscipline queue_discipline = QueueDiscipline::kFifo;
+        std::chrono::milliseconds queue_target = std::chrono::milliseconds(5);
+        std::chrono::milliseconds queue_interval =
+            std::chrono::milliseconds(100);
+        std::chrono::milliseconds queue_budget =
+            std::chrono::milliseconds(1000);
+        // Past these limits new connections get 503 Service Unavailable
+        // from the accepting thread and are closed, 0 means no limit.
+        // Open connections, for kReusePort per listener.
+        size_t max_connections = 0;
+        // Tasks waiting for a worker in kBlocking and kEventLoop.
+        size_t max_planned_tasks = 0;
+        // Sent as Retry-After with the 503 response.
+        std::chrono::seconds overload_retry_after = std::chrono::seconds(1);
     };
 
     enum class CreateError {
@@ -36,7 +126,9 @@ class HttpServer {
         kWrongAddress = 1,
         kAddressInUse = 2,
         kNoAccess = 3,
-        kPoolCreation = 4
+        kPoolCreation = 4,
+        kEventLoopCreation = 5,
+        kNotSupported = 6,
     };
 
     HttpServer() = delete;
@@ -45,6 +137,7 @@ class HttpServer {
 
     static std::unique_ptr<HttpServer> create(HttpConnectionHandler handler,
                                               CreateError& error);
+    // Options::io_backend is replaced by the backend actually used.
     static std::unique_ptr<HttpServer> create(Options options,
                                               HttpConnectionHandler handler,
                                               CreateError& error);
@@ -53,18 +146,48 @@ class HttpServer {
     ListenError listen(int port, std::string hostname);
     ListenError listen(int port, std::string hostname, size_t backlog);
 
+    const Options& getOptions() const { return options_; };
+
    private:
     struct ThreadState {
         std::vector<char> request_buffer;
         std::vector<char> response_buffer;
+        RequestArena arena;
     };
 
     HttpServer(Options options, HttpConnectionHandler handler)
         : options_(options), handler_(handler){};
 
+    std::unique_ptr<Server> createListener(int port,
+                                           const std::string& hostname,
+                                           size_t backlog, bool reuse_port,
+                                           ListenError& error);
+
+    std::unique_ptr<ThreadPool<ThreadState>> createThreadPool();
+
+    std::unique_ptr<ThreadState> createThreadState();
+
+    std::unique_ptr<EventLoop> createEventLoop(Server& tcp_server,
+                                               ListenError& error);
+
+    ListenError serveBlocking(Server& tcp_server);
+
+    ListenError serveWithEventLoop(Server& tcp_server);
+
+    ListenError serveWithReusePort(int port, const std::string& hostname,
+                                   size_t backlog);
+
+    // Serves the connections of one listener on the calling thread.
+    ListenError serveLocally(Server& tcp_server);
+
     Options options_;
     HttpConnectionHandler handler_;
 
+    // The 503 response for connections over the limits, serialized once.
+    std::string overload_response_;
+    // Connections accepted by the blocking model and not closed yet.
+    std::atomic<size_t> connections_count_ = 0;
+
     bool should_cleanup_library_ = false;
 };
 
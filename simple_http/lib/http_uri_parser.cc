@@ -7,34 +7,10 @@
 #include <charconv>
 #include <optional>
 #include <string_view>
-#include <unordered_set>
 
-namespace simple_http {
-
-static const std::unordered_set<char> kSubDelims{'!', '$', '&', '\'', '(', ')',
-                                                 '*', '+', ',', ';',  '='};
-
-static const std::unordered_set<char> kUnreserved{'-', '.', '_', '~'};
-
-static bool IsAlpha(char symbol) {
-    return (symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z');
-}
-
-static bool IsDigit(char symbol) { return symbol >= '0' && symbol <= '9'; }
+#include "char_classes.h"
 
-static bool IsSubDelims(char symbol) {
-    return kSubDelims.find(symbol) != kSubDelims.end();
-}
-
-static bool IsUnreserved(char symbol) {
-    return IsAlpha(symbol) || IsDigit(symbol) ||
-           kUnreserved.find(symbol) != kUnreserved.end();
-}
-
-static bool IsHex(char symbol) {
-    return IsDigit(symbol) || (symbol >= 'a' && symbol <= 'f') ||
-           (symbol >= 'A' && symbol <= 'F');
-}
+namespace simple_http {
 
 std::optional<HttpUriParser::UriParts> HttpUriParser::parseUri(
     const std::string_view& line) {
@@ -132,7 +108,8 @@ std::optional<std::string_view> HttpUriParser::parseIPv4Address(
     const std::string_view& line, State& state) {
     constexpr size_t kDecimalsCount = 4;
 
-    if (state.index >= line.length() || !IsDigit(line[state.index])) {
+    if (state.index >= line.length() ||
+        !IsCharClass(line[state.index], kDigit)) {
         return std::nullopt;
     }
 
@@ -178,7 +155,7 @@ std::optional<std::string_view> HttpUriParser::parseDecimal(
     const std::string_view& line, State& state) {
     size_t start = state.index;
     size_t index = state.index;
-    while (index < line.length() && IsDigit(line[index]) &&
+    while (index < line.length() && IsCharClass(line[index], kDigit) &&
            (line[index] != '0' || start != index)) {
         index++;
     }
@@ -194,12 +171,13 @@ std::optional<std::string_view> HttpUriParser::parseDecimal(
 std::optional<std::string_view> HttpUriParser::parseHostname(
     const std::string_view& line, State& state) {
     size_t start = state.index;
-    if (state.index >= line.length() || IsDigit(line[state.index])) {
+    if (state.index >= line.length() ||
+        IsCharClass(line[state.index], kDigit)) {
         return std::nullopt;
     }
 
     while (state.index < line.length()) {
-        if (IsUnreserved(line[state.index]) || IsSubDelims(line[state.index])) {
+        if (IsCharClass(line[state.index], kUnreserved | kSubDelims)) {
             state.index++;
         } else {
             if (!parseEncodedSymbol(line, state)) {
@@ -224,7 +202,7 @@ std::optional<std::string_view> HttpUriParser::parsePort(
     size_t start = state.index;
     size_t index = state.index;
     size_t first_non_zero = -1;
-    while (index < line.length() && IsDigit(line[index])) {
+    while (index < line.length() && IsCharClass(line[index], kDigit)) {
         if (line[index] != '0' && first_non_zero == -1) {
             first_non_zero = index;
         }
@@ -284,9 +262,7 @@ std::optional<std::string_view> HttpUriParser::parseAbsolutePath(
 bool HttpUriParser::parseSegment(const std::string_view& line, State& state) {
     size_t start = state.index;
     while (state.index < line.length()) {
-        auto symbol = line[state.index];
-        if (IsUnreserved(symbol) || IsSubDelims(symbol) || symbol == ':' ||
-            symbol == '@') {
+        if (IsCharClass(line[state.index], kPathChar)) {
             state.index++;
         } else {
             if (!parseEncodedSymbol(line, state)) {
@@ -310,9 +286,7 @@ std::optional<std::string_view> HttpUriParser::parseQuery(
 
     size_t start = state.index;
     while (state.index < line.length()) {
-        auto symbol = line[state.index];
-        if (IsUnreserved(symbol) || IsSubDelims(symbol) || symbol == ':' ||
-            symbol == '@' || symbol == '/' || symbol == '?') {
+        if (IsCharClass(line[state.index], kQueryChar)) {
             state.index++;
         } else {
             if (!parseEncodedSymbol(line, state)) {
@@ -334,8 +308,9 @@ bool HttpUriParser::parseEncodedSymbol(const std::string_view& line,
         return false;
     }
 
-    if (line.length() - state.index < 2 || !IsHex(line[state.index]) ||
-        !IsHex(line[state.index + 1])) {
+    if (line.length() - state.index < 2 ||
+        !IsCharClass(line[state.index], kHex) ||
+        !IsCharClass(line[state.index + 1], kHex)) {
         state.is_malformed = true;
         return false;
     }
@@ -8,4 +8,10 @@ namespace simple_http {
 
 enum class HttpVersion { kNone = -1, kHttp09, kHttp10, kHttp11 };
 
+// Version used in the status line of a response to a request of the given
+// version. Everything below HTTP/1.1 is answered as HTTP/1.0.
+inline const char* GetResponseVersionName(HttpVersion version) {
+    return version == HttpVersion::kHttp11 ? "HTTP/1.1" : "HTTP/1.0";
+}
+
 }  // namespace simple_http
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <string>
+#include <string_view>
 
 #include "http_request_data.h"
 #include "message_body.h"
@@ -19,13 +19,16 @@ class IncomingMessage {
 
     HttpMethod getMethod() const { return data_.method; };
 
-    const std::string& getMethodName() const { return data_.method_name; };
+    // The views below are valid until the response ends, a handler keeping
+    // them longer has to copy.
 
-    const std::string& getHref() const { return data_.href; };
+    std::string_view getMethodName() const { return data_.method_name; };
 
-    const std::string& getPath() const { return data_.path; };
+    std::string_view getHref() const { return data_.href; };
 
-    const std::string& getQuery() const { return data_.query; };
+    std::string_view getPath() const { return data_.path; };
+
+    std::string_view getQuery() const { return data_.query; };
 
     HttpVersion getHttpVersion() const { return data_.http_version; };
 
@@ -0,0 +1,553 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "io_uring_event_loop.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#include "event_loop.h"
+#include "socket_descriptor.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+#undef min
+
+namespace simple_http {
+
+#if defined(__linux__) && defined(IORING_ACCEPT_MULTISHOT)
+
+constexpr int kInvalidDescriptor = -1;
+
+constexpr unsigned kRingEntries = 512;
+
+constexpr uint16_t kBufferCount = 1024;
+
+constexpr size_t kBufferLength = 4096;
+
+constexpr uint16_t kBufferGroup = 0;
+
+// Completions of the listener, the wake descriptor and cancellations are
+// told apart from connections by user data no connection can have.
+constexpr uint64_t kAcceptTag = ~uint64_t(0);
+constexpr uint64_t kWakeTag = ~uint64_t(0) - 1;
+constexpr uint64_t kCancelTag = ~uint64_t(0) - 2;
+
+static uint64_t GetReceiveTag(SocketDescriptor descriptor,
+                              uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) |
+           static_cast<uint32_t>(descriptor);
+}
+
+static int Setup(unsigned entries, io_uring_params& params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+static int Enter(int ring_descriptor, unsigned submit_count,
+                 unsigned wait_count, unsigned flags, const void* argument,
+                 size_t argument_length) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring_descriptor,
+                                      submit_count, wait_count, flags,
+                                      argument, argument_length));
+}
+
+static int Register(int ring_descriptor, unsigned opcode, void* argument,
+                    unsigned arguments_count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ring_descriptor,
+                                      opcode, argument, arguments_count));
+}
+
+static unsigned LoadAcquire(unsigned* value) {
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+static void StoreRelease(unsigned* value, unsigned new_value) {
+    std::atomic_ref<unsigned>(*value).store(new_value,
+                                            std::memory_order_release);
+}
+
+std::unique_ptr<EventLoop> IoUringEventLoop::create(
+    EventLoop::CreateError& error) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kRingEntries * 4;
+
+    int ring_descriptor = Setup(kRingEntries, params);
+    if (ring_descriptor < 0) {
+        error = errno == ENOSYS || errno == EPERM
+                    ? EventLoop::CreateError::kNotSupported
+                    : EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+
+    std::unique_ptr<IoUringEventLoop> event_loop(new IoUringEventLoop());
+    event_loop->ring_descriptor_ = ring_descriptor;
+
+    // Timed waits and a single mapping of both rings are required.
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 ||
+        (params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+        error = EventLoop::CreateError::kNotSupported;
+        return nullptr;
+    }
+
+    event_loop->ring_memory_length_ =
+        std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                 params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void* ring_memory =
+        ::mmap(nullptr, event_loop->ring_memory_length_,
+               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               ring_descriptor, IORING_OFF_SQ_RING);
+    if (ring_memory == MAP_FAILED) {
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+    event_loop->ring_memory_ = ring_memory;
+
+    event_loop->submissions_length_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* submissions =
+        ::mmap(nullptr, event_loop->submissions_length_,
+               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               ring_descriptor, IORING_OFF_SQES);
+    if (submissions == MAP_FAILED) {
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+    event_loop->submissions_ = static_cast<io_uring_sqe*>(submissions);
+
+    char* ring = static_cast<char*>(ring_memory);
+    event_loop->submission_head_ =
+        reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    event_loop->submission_tail_ =
+        reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    event_loop->submission_array_ =
+        reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    event_loop->submission_mask_ =
+        *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    event_loop->submission_entries_ = params.sq_entries;
+    event_loop->queued_tail_ = *event_loop->submission_tail_;
+
+    event_loop->completion_head_ =
+        reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    event_loop->completion_tail_ =
+        reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    event_loop->completions_ =
+        reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+    event_loop->completion_mask_ =
+        *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+
+    // The buffer ring is shared with the kernel, which picks a buffer for
+    // every receive and reports its id in the completion.
+    event_loop->buffer_ring_length_ = kBufferCount * sizeof(io_uring_buf);
+    void* buffer_ring =
+        ::mmap(nullptr, event_loop->buffer_ring_length_,
+               PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring == MAP_FAILED) {
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+    event_loop->buffer_ring_ = static_cast<io_uring_buf_ring*>(buffer_ring);
+
+    io_uring_buf_reg buffer_registration;
+    std::memset(&buffer_registration, 0, sizeof(buffer_registration));
+    buffer_registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+    buffer_registration.ring_entries = kBufferCount;
+    buffer_registration.bgid = kBufferGroup;
+    if (Register(ring_descriptor, IORING_REGISTER_PBUF_RING,
+                 &buffer_registration, 1) < 0) {
+        error = errno == EINVAL ? EventLoop::CreateError::kNotSupported
+                                : EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+
+    event_loop->buffers_.resize(kBufferCount * kBufferLength);
+    for (uint16_t buffer_id = 0; buffer_id < kBufferCount; buffer_id++) {
+        event_loop->provideBuffer(buffer_id);
+    }
+
+    int wake_descriptor = ::eventfd(0, EFD_CLOEXEC);
+    if (wake_descriptor == kInvalidDescriptor) {
+        error = EventLoop::CreateError::kUnknown;
+        return nullptr;
+    }
+    event_loop->wake_descriptor_ = wake_descriptor;
+    event_loop->submitWakeRead();
+
+    error = EventLoop::CreateError::kOk;
+    return event_loop;
+}
+
+bool IoUringEventLoop::isSupported() {
+    // A one-entry ring and a one-entry buffer ring are enough to check the
+    // features create() requires.
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ring_descriptor = Setup(1, params);
+    if (ring_descriptor < 0) {
+        return false;
+    }
+
+    bool is_supported = (params.features & IORING_FEAT_EXT_ARG) != 0 &&
+                        (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    size_t buffer_ring_length = sizeof(io_uring_buf);
+    void* buffer_ring =
+        ::mmap(nullptr, buffer_ring_length, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring == MAP_FAILED) {
+        is_supported = false;
+    } else if (is_supported) {
+        io_uring_buf_reg buffer_registration;
+        std::memset(&buffer_registration, 0, sizeof(buffer_registration));
+        buffer_registration.ring_addr =
+            reinterpret_cast<uint64_t>(buffer_ring);
+        buffer_registration.ring_entries = 1;
+        buffer_registration.bgid = kBufferGroup;
+        is_supported = Register(ring_descriptor, IORING_REGISTER_PBUF_RING,
+                                &buffer_registration, 1) == 0;
+    }
+
+    ::close(ring_descriptor);
+    if (buffer_ring != MAP_FAILED) {
+        ::munmap(buffer_ring, buffer_ring_length);
+    }
+
+    return is_supported;
+}
+
+IoUringEventLoop::~IoUringEventLoop() {
+    if (wake_descriptor_ != kInvalidDescriptor) {
+        ::close(wake_descriptor_);
+    }
+    if (ring_descriptor_ != kInvalidDescriptor) {
+        ::close(ring_descriptor_);
+    }
+    if (buffer_ring_ != nullptr) {
+        ::munmap(buffer_ring_, buffer_ring_length_);
+    }
+    if (submissions_ != nullptr) {
+        ::munmap(submissions_, submissions_length_);
+    }
+    if (ring_memory_ != nullptr) {
+        ::munmap(ring_memory_, ring_memory_length_);
+    }
+}
+
+io_uring_sqe* IoUringEventLoop::getSubmission() {
+    if (queued_tail_ - LoadAcquire(submission_head_) == submission_entries_) {
+        submit(0, std::chrono::milliseconds(0));
+    }
+
+    unsigned index = queued_tail_ & submission_mask_;
+    io_uring_sqe* submission = &submissions_[index];
+    std::memset(submission, 0, sizeof(io_uring_sqe));
+    submission_array_[index] = index;
+    queued_tail_++;
+    return submission;
+}
+
+int IoUringEventLoop::submit(unsigned wait_count,
+                             std::chrono::milliseconds timeout) {
+    StoreRelease(submission_tail_, queued_tail_);
+    unsigned submit_count = queued_tail_ - LoadAcquire(submission_head_);
+
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    __kernel_timespec timespec;
+    io_uring_getevents_arg argument;
+    std::memset(&argument, 0, sizeof(argument));
+    if (wait_count > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout.count() >= 0) {
+            timespec.tv_sec = timeout.count() / 1000;
+            timespec.tv_nsec = (timeout.count() % 1000) * 1000000;
+            argument.ts = reinterpret_cast<uint64_t>(&timespec);
+        }
+    }
+
+    return Enter(ring_descriptor_, submit_count, wait_count, flags, &argument,
+                 sizeof(argument));
+}
+
+void IoUringEventLoop::submitAccept() {
+    io_uring_sqe* submission = getSubmission();
+    submission->opcode = IORING_OP_ACCEPT;
+    submission->fd = listener_descriptor_;
+    submission->ioprio = IORING_ACCEPT_MULTISHOT;
+    submission->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    submission->user_data = kAcceptTag;
+}
+
+void IoUringEventLoop::submitWakeRead() {
+    io_uring_sqe* submission = getSubmission();
+    submission->opcode = IORING_OP_READ;
+    submission->fd = wake_descriptor_;
+    submission->addr = reinterpret_cast<uint64_t>(&wake_value_);
+    submission->len = sizeof(wake_value_);
+    submission->user_data = kWakeTag;
+}
+
+EventLoop::WatchError IoUringEventLoop::submitReceive(
+    SocketDescriptor descriptor, void* data) {
+    assert(data != nullptr);
+
+    if (descriptor < 0) {
+        return EventLoop::WatchError::kUnknown;
+    }
+
+    size_t index = static_cast<size_t>(descriptor);
+    if (index >= watches_.size()) {
+        watches_.resize(std::max(index + 1, watches_.size() * 2));
+    }
+
+    Watch& watch = watches_[index];
+    if (watch.data != data) {
+        watch.data = data;
+        watch.generation++;
+    }
+    watch.is_pending = true;
+
+    io_uring_sqe* submission = getSubmission();
+    submission->opcode = IORING_OP_RECV;
+    submission->fd = descriptor;
+    submission->flags = IOSQE_BUFFER_SELECT;
+    submission->buf_group = kBufferGroup;
+    submission->len = 0;
+    submission->user_data = GetReceiveTag(descriptor, watch.generation);
+    return EventLoop::WatchError::kOk;
+}
+
+void IoUringEventLoop::provideBuffer(uint16_t buffer_id) {
+    // Not buffer_ring_->bufs: in C++ the empty struct in front of that
+    // flexible array takes space and moves it off the ring start.
+    io_uring_buf& buffer = reinterpret_cast<io_uring_buf*>(
+        buffer_ring_)[buffer_ring_tail_ & (kBufferCount - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(buffers_.data() +
+                                             buffer_id * kBufferLength);
+    buffer.len = kBufferLength;
+    buffer.bid = buffer_id;
+    buffer_ring_tail_++;
+
+    std::atomic_ref<uint16_t>(buffer_ring_->tail)
+        .store(buffer_ring_tail_, std::memory_order_release);
+}
+
+EventLoop::WatchError IoUringEventLoop::addListener(
+    SocketDescriptor descriptor, void* data) {
+    assert(data != nullptr);
+
+    listener_descriptor_ = descriptor;
+    listener_data_ = data;
+    submitAccept();
+    return EventLoop::WatchError::kOk;
+}
+
+EventLoop::WatchError IoUringEventLoop::rearmListener(SocketDescriptor,
+                                                      void*) {
+    // The multishot accept stays armed.
+    return EventLoop::WatchError::kOk;
+}
+
+EventLoop::WatchError IoUringEventLoop::add(SocketDescriptor descriptor,
+                                            void* data) {
+    return submitReceive(descriptor, data);
+}
+
+EventLoop::WatchError IoUringEventLoop::rearm(SocketDescriptor descriptor,
+                                              void* data) {
+    return submitReceive(descriptor, data);
+}
+
+void IoUringEventLoop::remove(SocketDescriptor descriptor, void* data) {
+    size_t index = static_cast<size_t>(descriptor);
+    if (descriptor < 0 || index >= watches_.size() ||
+        watches_[index].data != data) {
+        return;
+    }
+
+    // A pending receive keeps the connection open in the kernel until it
+    // is cancelled, its completion is then ignored as stale.
+    Watch& watch = watches_[index];
+    if (watch.is_pending) {
+        io_uring_sqe* submission = getSubmission();
+        submission->opcode = IORING_OP_ASYNC_CANCEL;
+        submission->fd = -1;
+        submission->addr = GetReceiveTag(descriptor, watch.generation);
+        submission->user_data = kCancelTag;
+    }
+
+    watch.data = nullptr;
+    watch.generation++;
+    watch.is_pending = false;
+}
+
+void IoUringEventLoop::releaseBuffer(const EventLoop::Event& event) {
+    if (event.type == EventLoop::Event::Type::kReceived &&
+        event.received_data != nullptr) {
+        provideBuffer(event.buffer_id);
+    }
+}
+
+bool IoUringEventLoop::takeCompletion(const io_uring_cqe& completion,
+                                      EventLoop::Event& event) {
+    bool has_buffer = (completion.flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t buffer_id =
+        static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+
+    switch (completion.user_data) {
+        case kCancelTag:
+            return false;
+        case kWakeTag:
+            submitWakeRead();
+            return false;
+        case kAcceptTag:
+            if ((completion.flags & IORING_CQE_F_MORE) == 0) {
+                submitAccept();
+            }
+            if (completion.res < 0) {
+                return false;
+            }
+
+            event = EventLoop::Event();
+            event.type = EventLoop::Event::Type::kAccepted;
+            event.data = listener_data_;
+            event.accepted_descriptor = completion.res;
+            return true;
+        default:
+            break;
+    }
+
+    size_t index = static_cast<uint32_t>(completion.user_data);
+    uint32_t generation = static_cast<uint32_t>(completion.user_data >> 32);
+    if (index >= watches_.size() ||
+        watches_[index].generation != generation ||
+        !watches_[index].is_pending) {
+        if (has_buffer) {
+            provideBuffer(buffer_id);
+        }
+        return false;
+    }
+
+    Watch& watch = watches_[index];
+    watch.is_pending = false;
+
+    event = EventLoop::Event();
+    event.data = watch.data;
+    if (completion.res < 0) {
+        // Out of buffers or a failed receive, the connection reads the
+        // socket itself and sees the error or the data.
+        event.type = EventLoop::Event::Type::kReadable;
+        return true;
+    }
+
+    event.type = EventLoop::Event::Type::kReceived;
+    if (has_buffer) {
+        event.received_data = buffers_.data() + buffer_id * kBufferLength;
+        event.buffer_id = buffer_id;
+    }
+    event.received_length = static_cast<size_t>(completion.res);
+    if (event.received_length == 0 && has_buffer) {
+        provideBuffer(buffer_id);
+        event.received_data = nullptr;
+    }
+    return true;
+}
+
+size_t IoUringEventLoop::wait(EventLoop::Event* events,
+                              size_t events_capacity,
+                              std::chrono::milliseconds timeout,
+                              EventLoop::WaitError& error) {
+    assert(events_capacity > 0);
+
+    unsigned head = *completion_head_;
+    bool has_completions = head != LoadAcquire(completion_tail_);
+    if (submit(has_completions ? 0 : 1, timeout) < 0 && errno != ETIME &&
+        errno != EBUSY) {
+        error = errno == EINTR ? EventLoop::WaitError::kInterrupt
+                               : EventLoop::WaitError::kUnknown;
+        return 0;
+    }
+
+    size_t ready_count = 0;
+    unsigned tail = LoadAcquire(completion_tail_);
+    while (head != tail && ready_count < events_capacity) {
+        const io_uring_cqe& completion = completions_[head & completion_mask_];
+        if (takeCompletion(completion, events[ready_count])) {
+            ready_count++;
+        }
+        head++;
+    }
+    StoreRelease(completion_head_, head);
+
+    error = EventLoop::WaitError::kOk;
+    return ready_count;
+}
+
+void IoUringEventLoop::wake() {
+    uint64_t value = 1;
+    ::write(wake_descriptor_, &value, sizeof(value));
+}
+
+#else
+
+std::unique_ptr<EventLoop> IoUringEventLoop::create(
+    EventLoop::CreateError& error) {
+    error = EventLoop::CreateError::kNotSupported;
+    return nullptr;
+}
+
+bool IoUringEventLoop::isSupported() { return false; }
+
+IoUringEventLoop::~IoUringEventLoop() {}
+
+EventLoop::WatchError IoUringEventLoop::addListener(
+    SocketDescriptor descriptor, void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError IoUringEventLoop::rearmListener(
+    SocketDescriptor descriptor, void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError IoUringEventLoop::add(SocketDescriptor descriptor,
+                                            void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+EventLoop::WatchError IoUringEventLoop::rearm(SocketDescriptor descriptor,
+                                              void* data) {
+    return EventLoop::WatchError::kUnknown;
+}
+
+void IoUringEventLoop::remove(SocketDescriptor descriptor, void* data) {}
+
+void IoUringEventLoop::releaseBuffer(const EventLoop::Event& event) {}
+
+size_t IoUringEventLoop::wait(EventLoop::Event* events,
+                              size_t events_capacity,
+                              std::chrono::milliseconds timeout,
+                              EventLoop::WaitError& error) {
+    error = EventLoop::WaitError::kUnknown;
+    return 0;
+}
+
+void IoUringEventLoop::wake() {}
+
+#endif
+
+}  // namespace simple_http
@@ -0,0 +1,109 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "event_loop.h"
+#include "socket_descriptor.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace simple_http {
+
+// Completions from io_uring. The listening socket is served by a multishot
+// accept, connections by one-shot receives into a ring of buffers provided
+// to the kernel. Submissions are queued and handed to the kernel together
+// by wait().
+class IoUringEventLoop : public EventLoop {
+   public:
+    static std::unique_ptr<EventLoop> create(CreateError& error);
+
+    static bool isSupported();
+
+    ~IoUringEventLoop() override;
+
+    WatchError addListener(SocketDescriptor descriptor, void* data) override;
+
+    WatchError rearmListener(SocketDescriptor descriptor,
+                             void* data) override;
+
+    WatchError add(SocketDescriptor descriptor, void* data) override;
+
+    WatchError rearm(SocketDescriptor descriptor, void* data) override;
+
+    void remove(SocketDescriptor descriptor, void* data) override;
+
+    void releaseBuffer(const Event& event) override;
+
+    size_t wait(Event* events, size_t events_capacity,
+                std::chrono::milliseconds timeout, WaitError& error) override;
+
+    void wake() override;
+
+   private:
+    // A connection watched by a receive. The generation tells completions
+    // of a removed connection from the ones of a new connection reusing
+    // its descriptor.
+    struct Watch {
+        void* data = nullptr;
+        uint32_t generation = 0;
+        bool is_pending = false;
+    };
+
+    IoUringEventLoop() = default;
+
+    io_uring_sqe* getSubmission();
+
+    int submit(unsigned wait_count, std::chrono::milliseconds timeout);
+
+    void submitAccept();
+
+    void submitWakeRead();
+
+    WatchError submitReceive(SocketDescriptor descriptor, void* data);
+
+    void provideBuffer(uint16_t buffer_id);
+
+    bool takeCompletion(const io_uring_cqe& completion, Event& event);
+
+    int ring_descriptor_ = -1;
+    int wake_descriptor_ = -1;
+
+    void* ring_memory_ = nullptr;
+    size_t ring_memory_length_ = 0;
+    io_uring_sqe* submissions_ = nullptr;
+    size_t submissions_length_ = 0;
+
+    unsigned* submission_head_ = nullptr;
+    unsigned* submission_tail_ = nullptr;
+    unsigned* submission_array_ = nullptr;
+    unsigned submission_mask_ = 0;
+    unsigned submission_entries_ = 0;
+    unsigned queued_tail_ = 0;
+
+    unsigned* completion_head_ = nullptr;
+    unsigned* completion_tail_ = nullptr;
+    io_uring_cqe* completions_ = nullptr;
+    unsigned completion_mask_ = 0;
+
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    size_t buffer_ring_length_ = 0;
+    uint16_t buffer_ring_tail_ = 0;
+    std::vector<char> buffers_;
+
+    SocketDescriptor listener_descriptor_ = 0;
+    void* listener_data_ = nullptr;
+    uint64_t wake_value_ = 0;
+
+    std::vector<Watch> watches_;
+};
+
+}  // namespace simple_http
@@ -14,8 +14,12 @@ class MessageBody {
         kOk = 0,
         kConnectionClosed = 1,
         kBadSyntax = 2,
+        // The body arrived slower than allowed.
+        kTimedOut = 3,
     };
 
+    virtual ~MessageBody() = default;
+
     virtual size_t read(char* buffer, size_t length, ReadError& error) = 0;
 
     virtual ReadError consume() = 0;
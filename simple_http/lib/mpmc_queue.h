@@ -0,0 +1,113 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace simple_http {
+
+// Bounded lock-free queue for many producers and many consumers (Dmitry
+// Vyukov's ring). Every cell has a sequence number telling whether it is
+// free for the producer of a position or filled for its consumer, so
+// producers and consumers only contend on their own position counter.
+template <typename T>
+class MpmcQueue {
+   public:
+    // The capacity must be a power of two.
+    explicit MpmcQueue(size_t capacity)
+        : cells_(new Cell[capacity]), mask_(capacity - 1) {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+
+        for (size_t i = 0; i < capacity; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    };
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Returns false when the queue is full, the value is left untouched.
+    bool tryPush(T& value) {
+        Cell* cell;
+        size_t position = push_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference =
+                static_cast<intptr_t>(sequence) -
+                static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (push_position_.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = push_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    };
+
+    // Returns false when the queue is empty.
+    bool tryPop(T& value) {
+        Cell* cell;
+        size_t position = pop_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference =
+                static_cast<intptr_t>(sequence) -
+                static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (pop_position_.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = pop_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+    };
+
+    // Approximate while producers or consumers are running.
+    size_t getSize() const {
+        size_t push_position = push_position_.load(std::memory_order_relaxed);
+        size_t pop_position = pop_position_.load(std::memory_order_relaxed);
+        return push_position > pop_position ? push_position - pop_position
+                                            : 0;
+    };
+
+   private:
+    static constexpr size_t kCacheLineLength = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+
+    alignas(kCacheLineLength) std::atomic<size_t> push_position_ = 0;
+    alignas(kCacheLineLength) std::atomic<size_t> pop_position_ = 0;
+};
+
+}  // namespace simple_http
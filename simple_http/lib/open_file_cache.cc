@@ -0,0 +1,113 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "open_file_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file.h"
+
+#undef max
+
+namespace simple_http {
+
+OpenFileCache::OpenFileCache(const OpenFileCacheOptions& options)
+    : options_(options),
+      max_shard_entries_(std::max<size_t>(
+          1, (options.max_entries + options.shards_count - 1) /
+                 options.shards_count)),
+      shards_(new Shard[options.shards_count]) {
+    assert(options.shards_count > 0);
+}
+
+std::shared_ptr<const OpenFileCache::Entry> OpenFileCache::find(
+    std::string_view key) {
+    Shard& shard = getShard(key);
+    std::shared_ptr<const Entry> entry;
+    {
+        std::unique_lock lock(shard.mutex);
+        auto iterator = shard.index.find(key);
+        if (iterator == shard.index.end()) {
+            return nullptr;
+        }
+
+        Node& node = *iterator->second;
+        shard.nodes.splice(shard.nodes.begin(), shard.nodes,
+                           iterator->second);
+        Clock::time_point now = Clock::now();
+        if (now < node.valid_until) {
+            return node.entry;
+        }
+
+        // Other lookups keep using the file while this one checks it.
+        node.valid_until = now + options_.valid_time;
+        entry = node.entry;
+    }
+
+    File::OpenError error;
+    File::Status status = File::readStatus(entry->path, error);
+    if (error == File::OpenError::kOk && status == entry->file->getStatus()) {
+        return entry;
+    }
+
+    std::unique_lock lock(shard.mutex);
+    remove(shard, key, entry.get());
+    return nullptr;
+}
+
+void OpenFileCache::insert(std::string_view key,
+                           std::shared_ptr<const Entry> entry) {
+    assert(entry->file != nullptr);
+
+    Shard& shard = getShard(key);
+    std::unique_lock lock(shard.mutex);
+    auto iterator = shard.index.find(key);
+    if (iterator != shard.index.end()) {
+        remove(shard, key, iterator->second->entry.get());
+    }
+
+    if (shard.nodes.size() == max_shard_entries_) {
+        const Node& last = shard.nodes.back();
+        remove(shard, last.key, last.entry.get());
+    }
+
+    shard.nodes.push_front(Node{std::string(key), std::move(entry),
+                                Clock::now() + options_.valid_time});
+    shard.index.emplace(shard.nodes.front().key, shard.nodes.begin());
+}
+
+void OpenFileCache::clear() {
+    for (size_t i = 0; i < options_.shards_count; i++) {
+        std::unique_lock lock(shards_[i].mutex);
+        shards_[i].index.clear();
+        shards_[i].nodes.clear();
+    }
+}
+
+OpenFileCache::Shard& OpenFileCache::getShard(std::string_view key) {
+    return shards_[std::hash<std::string_view>()(key) %
+                   options_.shards_count];
+}
+
+void OpenFileCache::remove(Shard& shard, std::string_view key,
+                           const Entry* entry) {
+    auto iterator = shard.index.find(key);
+    if (iterator == shard.index.end() ||
+        iterator->second->entry.get() != entry) {
+        return;
+    }
+
+    auto node = iterator->second;
+    shard.index.erase(iterator);
+    shard.nodes.erase(node);
+}
+
+}  // namespace simple_http
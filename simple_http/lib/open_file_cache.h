@@ -0,0 +1,85 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "file.h"
+
+namespace simple_http {
+
+struct OpenFileCacheOptions {
+    // Open files kept at most, split evenly between the shards.
+    size_t max_entries = 1024;
+    // How long a file is served without checking it on the disk.
+    std::chrono::milliseconds valid_time = std::chrono::milliseconds(30000);
+    // Shards have separate locks, so workers rarely wait for each other.
+    size_t shards_count = 16;
+};
+
+// Open files by a key, e.g. the request path, so that serving a file takes
+// no open() or stat() calls (like the open file cache of nginx). Once the
+// valid time passes, the next lookup compares the file on the disk with
+// the open one and drops the entry if it changed. Entries are shared, an
+// evicted file is closed when the last request sending it is done. Every
+// shard evicts its least recently used entry. Thread-safe.
+class OpenFileCache {
+   public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::filesystem::path path;
+        std::unique_ptr<File> file;
+        // The response head for the file, if its owner serializes one.
+        std::string head;
+    };
+
+    explicit OpenFileCache(const OpenFileCacheOptions& options = {});
+
+    OpenFileCache(const OpenFileCache&) = delete;
+    OpenFileCache& operator=(const OpenFileCache&) = delete;
+
+    // Returns nullptr when the key is not cached or its file has changed.
+    std::shared_ptr<const Entry> find(std::string_view key);
+
+    // Replaces the entry of the key. The entry must have an open file.
+    void insert(std::string_view key, std::shared_ptr<const Entry> entry);
+
+    void clear();
+
+   private:
+    struct Node {
+        std::string key;
+        std::shared_ptr<const Entry> entry;
+        Clock::time_point valid_until;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        // The most recently used first.
+        std::list<Node> nodes;
+        // Keys point into the nodes.
+        std::unordered_map<std::string_view, std::list<Node>::iterator> index;
+    };
+
+    Shard& getShard(std::string_view key);
+
+    // Removes the node of the key if it still holds the entry.
+    void remove(Shard& shard, std::string_view key, const Entry* entry);
+
+    OpenFileCacheOptions options_;
+    size_t max_shard_entries_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace simple_http
@@ -4,6 +4,11 @@
 
 #include "outgoing_message.h"
 
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+#include "file.h"
 #include "http_method.h"
 #include "http_version.h"
 
@@ -20,16 +25,31 @@ OutgoingMessage::WriteHeadError OutgoingMessage::writeHead(
         return WriteHeadError::kOk;
     }
 
-    std::string response_line = "HTTP/1.0 " + code + " " + message + "\r\n";
-    SocketWriter::WriteError write_error;
-    write_error = output_.write(response_line);
-    if (write_error != SocketWriter::WriteError::kOk) {
-        return WriteHeadError::kConnectionClosed;
+    is_keep_alive_ = request_data_.keep_alive && isKeepAlivePossible(code);
+    if (headers_.count(HttpHeaderId::kConnection) == 0) {
+        if (request_data_.http_version == HttpVersion::kHttp11 &&
+            !is_keep_alive_) {
+            headers_.add(HttpHeaderId::kConnection, "close");
+        } else if (request_data_.http_version == HttpVersion::kHttp10 &&
+                   is_keep_alive_) {
+            headers_.add(HttpHeaderId::kConnection, "keep-alive");
+        }
     }
 
-    WriteError write_headers_error;
-    write_headers_error = writeHeaders();
-    return write_headers_error == WriteError::kOk
+    // The status line and the headers are written at once.
+    std::pmr::string head(resource_);
+    head.reserve(256);
+    head += GetResponseVersionName(request_data_.http_version);
+    head += ' ';
+    head += code;
+    head += ' ';
+    head += message;
+    head += "\r\n";
+    appendHeaders(head);
+
+    SocketWriter::WriteError write_error;
+    write_error = output_.write(head.data(), head.length());
+    return write_error == SocketWriter::WriteError::kOk
                ? WriteHeadError::kOk
                : WriteHeadError::kConnectionClosed;
 }
@@ -59,6 +79,75 @@ OutgoingMessage::WriteError OutgoingMessage::write(const char* buffer,
                : WriteError::kConnectionClosed;
 }
 
+OutgoingMessage::WriteError OutgoingMessage::sendFile(
+    FileDescriptor file_descriptor, uint64_t offset, size_t length) {
+    if (!is_head_sent_) {
+        WriteHeadError write_head_error;
+        write_head_error = writeHead("200", "OK");
+        if (write_head_error != WriteHeadError::kOk) {
+            return WriteError::kConnectionClosed;
+        }
+    }
+
+    if (request_data_.method == HttpMethod::kHead) {
+        return WriteError::kOk;
+    }
+
+    SocketWriter::WriteError write_error;
+    write_error = output_.writeFile(file_descriptor, offset, length);
+    switch (write_error) {
+        case SocketWriter::WriteError::kOk:
+            return WriteError::kOk;
+        case SocketWriter::WriteError::kFileError:
+            return WriteError::kFileError;
+        default:
+            return WriteError::kConnectionClosed;
+    }
+}
+
+OutgoingMessage::WriteError OutgoingMessage::writeSerialized(
+    std::string_view head, std::string_view body) {
+    assert(!is_head_sent_);
+
+    is_head_sent_ = true;
+
+    if (request_data_.http_version != HttpVersion::kHttp09) {
+        // The head has Content-Length, so only the request decides.
+        is_keep_alive_ = request_data_.keep_alive;
+        std::string_view head_end = "\r\n";
+        if (request_data_.http_version == HttpVersion::kHttp11 &&
+            !is_keep_alive_) {
+            head_end = "Connection: close\r\n\r\n";
+        } else if (request_data_.http_version == HttpVersion::kHttp10 &&
+                   is_keep_alive_) {
+            head_end = "Connection: keep-alive\r\n\r\n";
+        }
+
+        // The parts are copied to the output buffer, so they go out in one
+        // system call together with the body.
+        std::string_view version =
+            GetResponseVersionName(request_data_.http_version);
+        if (output_.write(version.data(), version.length()) !=
+                SocketWriter::WriteError::kOk ||
+            output_.write(head.data(), head.length()) !=
+                SocketWriter::WriteError::kOk ||
+            output_.write(head_end.data(), head_end.length()) !=
+                SocketWriter::WriteError::kOk) {
+            return WriteError::kConnectionClosed;
+        }
+    }
+
+    if (request_data_.method == HttpMethod::kHead) {
+        return WriteError::kOk;
+    }
+
+    SocketWriter::WriteError write_error;
+    write_error = output_.write(body.data(), body.length());
+    return write_error == SocketWriter::WriteError::kOk
+               ? WriteError::kOk
+               : WriteError::kConnectionClosed;
+}
+
 OutgoingMessage::EndError OutgoingMessage::end() {
     if (is_ended_) {
         return EndError::kOk;
@@ -66,6 +155,10 @@ OutgoingMessage::EndError OutgoingMessage::end() {
 
     is_ended_ = true;
 
+    if (is_flush_deferred_ && is_keep_alive_) {
+        return EndError::kOk;
+    }
+
     FlushError flush_error;
     flush_error = flush();
     return flush_error == FlushError::kOk ? EndError::kOk
@@ -80,41 +173,29 @@ OutgoingMessage::FlushError OutgoingMessage::flush() {
                : FlushError::kConnectionClosed;
 }
 
-OutgoingMessage::WriteError OutgoingMessage::writeHeaders() {
-    SocketWriter::WriteError write_error;
-    for (auto it = headers_.begin(); it != headers_.end(); it++) {
-        auto& name = it->first;
-        auto& header_values = it->second;
-        for (auto value_it = header_values.begin();
-             value_it != header_values.end(); value_it++) {
-            write_error = output_.write(name);
-            if (write_error != simple_http::SocketWriter::WriteError::kOk) {
-                return WriteError::kConnectionClosed;
-            }
-
-            write_error = output_.write(": ");
-            if (write_error != simple_http::SocketWriter::WriteError::kOk) {
-                return WriteError::kConnectionClosed;
-            }
-
-            write_error = output_.write(*value_it);
-            if (write_error != simple_http::SocketWriter::WriteError::kOk) {
-                return WriteError::kConnectionClosed;
-            }
-
-            write_error = output_.write("\r\n");
-            if (write_error != simple_http::SocketWriter::WriteError::kOk) {
-                return WriteError::kConnectionClosed;
-            }
+bool OutgoingMessage::isKeepAlivePossible(const std::string& code) {
+    for (const HttpHeaders::Header& header : headers_) {
+        if (header.id == HttpHeaderId::kConnection && header.value == "close") {
+            return false;
         }
     }
 
-    write_error = output_.write("\r\n");
-    if (write_error != simple_http::SocketWriter::WriteError::kOk) {
-        return WriteError::kConnectionClosed;
+    // Without a known length the body is delimited by closing the
+    // connection.
+    return request_data_.method == HttpMethod::kHead || code == "204" ||
+           code == "304" || code.starts_with("1") ||
+           headers_.count(HttpHeaderId::kContentLength) != 0;
+}
+
+void OutgoingMessage::appendHeaders(std::pmr::string& head) {
+    for (const HttpHeaders::Header& header : headers_) {
+        head += header.name;
+        head += ": ";
+        head += header.value;
+        head += "\r\n";
     }
 
-    return WriteError::kOk;
+    head += "\r\n";
 }
 
 }  // namespace simple_http
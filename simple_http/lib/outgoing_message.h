@@ -4,6 +4,12 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "file.h"
 #include "http_headers.h"
 #include "http_request_data.h"
 #include "socket_writer.h"
@@ -21,6 +27,7 @@ class OutgoingMessage {
     enum class WriteError {
         kOk = 0,
         kConnectionClosed = 1,
+        kFileError = 2,
     };
 
     enum class EndError {
@@ -35,8 +42,18 @@ class OutgoingMessage {
 
     OutgoingMessage() = delete;
 
-    OutgoingMessage(const HttpRequestData& request_data, SocketWriter& output)
-        : request_data_(request_data), output_(output){};
+    // With is_flush_deferred end() leaves the response in the output buffer,
+    // so that responses to pipelined requests go out in one send. Headers
+    // and the head are allocated from the resource.
+    OutgoingMessage(
+        const HttpRequestData& request_data, SocketWriter& output,
+        bool is_flush_deferred = false,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : request_data_(request_data),
+          output_(output),
+          resource_(resource),
+          headers_(resource),
+          is_flush_deferred_(is_flush_deferred){};
 
     HttpHeaders& getHeaders() { return headers_; };
 
@@ -46,6 +63,19 @@ class OutgoingMessage {
     WriteError write(const std::string& data);
     WriteError write(const char* buffer, size_t length);
 
+    // Writes length bytes of a file starting at offset as a part of the
+    // body. Large parts are sent by the kernel without copying them
+    // through the output buffer. On kFileError the connection is closed.
+    WriteError sendFile(FileDescriptor file_descriptor, uint64_t offset,
+                        size_t length);
+
+    // Writes a whole response prepared beforehand. The head is everything
+    // between the version and the end of the headers, e.g.
+    // " 200 OK\r\nContent-Length: 2\r\n". It must have Content-Length
+    // and no Connection, which is added as writeHead() would do. Headers
+    // from getHeaders() are not sent.
+    WriteError writeSerialized(std::string_view head, std::string_view body);
+
     EndError end();
 
     FlushError flush();
@@ -54,16 +84,25 @@ class OutgoingMessage {
 
     bool isEnded() { return is_ended_; }
 
+    // Whether the connection stays open after this response. Known once the
+    // head is written.
+    bool isKeepAlive() { return is_keep_alive_; }
+
    private:
-    WriteError writeHeaders();
+    bool isKeepAlivePossible(const std::string& code);
+
+    void appendHeaders(std::pmr::string& head);
 
     const HttpRequestData& request_data_;
     SocketWriter& output_;
+    std::pmr::memory_resource* resource_;
 
     HttpHeaders headers_;
 
+    bool is_flush_deferred_ = false;
     bool is_head_sent_ = false;
     bool is_ended_ = false;
+    bool is_keep_alive_ = false;
 };
 
 }  // namespace simple_http
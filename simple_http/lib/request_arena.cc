@@ -0,0 +1,45 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "request_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace simple_http {
+
+RequestArena::RequestArena(size_t initial_length) { addChunk(initial_length); }
+
+void RequestArena::reset() {
+    chunk_index_ = 0;
+    chunk_used_ = 0;
+}
+
+void* RequestArena::do_allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        Chunk& chunk = chunks_[chunk_index_];
+        size_t start = (chunk_used_ + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= chunk.length) {
+            chunk_used_ = start + bytes;
+            return chunk.data.get() + start;
+        }
+
+        chunk_index_++;
+        chunk_used_ = 0;
+        if (chunk_index_ == chunks_.size()) {
+            // Chunks start aligned for any type.
+            addChunk(std::max(chunk.length * 2, bytes + alignment));
+        }
+    }
+}
+
+void RequestArena::addChunk(size_t length) {
+    Chunk chunk;
+    chunk.data = std::make_unique<std::byte[]>(length);
+    chunk.length = length;
+    chunks_.push_back(std::move(chunk));
+}
+
+}  // namespace simple_http
@@ -0,0 +1,49 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace simple_http {
+
+// Bump allocator for objects of one request at a time. Deallocation does
+// nothing, reset() makes all the memory free again. Chunks are kept between
+// requests, so once it has grown serving a request takes no allocations.
+class RequestArena : public std::pmr::memory_resource {
+   public:
+    explicit RequestArena(size_t initial_length = 16384);
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // Every object allocated before must be already destroyed.
+    void reset();
+
+   private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        size_t length;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    };
+
+    void addChunk(size_t length);
+
+    std::vector<Chunk> chunks_;
+    size_t chunk_index_ = 0;
+    size_t chunk_used_ = 0;
+};
+
+}  // namespace simple_http
@@ -24,6 +24,7 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -49,6 +50,10 @@ Server::BindError Server::bind(const Server::BindOptions& options) {
         return Server::BindError::kWrongAddress;
     }
 
+    if (options.reuse_port) {
+        return Server::BindError::kNotSupported;
+    }
+
     int bind_result = ::bind(socket_descriptor_,
                              reinterpret_cast<::sockaddr*>(&socket_address),
                              sizeof(socket_address));
@@ -83,6 +88,15 @@ Server::ListenError Server::listen(const Server::ListenOptions& options) {
 }
 
 std::unique_ptr<Socket> Server::accept(Server::AcceptError& error) {
+    SocketDescriptor client_socket_descriptor = acceptDescriptor(error);
+    if (error != Server::AcceptError::kOk) {
+        return nullptr;
+    }
+
+    return std::make_unique<Socket>(client_socket_descriptor);
+}
+
+SocketDescriptor Server::acceptDescriptor(Server::AcceptError& error) {
     assert(is_binded_);
     assert(is_listening_);
 
@@ -92,15 +106,17 @@ std::unique_ptr<Socket> Server::accept(Server::AcceptError& error) {
         int inner_error = ::WSAGetLastError();
         if (inner_error == WSAEINTR) {
             error = Server::AcceptError::kInterrupt;
+        } else if (inner_error == WSAEWOULDBLOCK) {
+            error = Server::AcceptError::kWouldBlock;
         } else {
             error = Server::AcceptError::kUnknown;
         }
 
-        return nullptr;
+        return client_socket_descriptor;
     }
 
     error = Server::AcceptError::kOk;
-    return std::make_unique<Socket>(client_socket_descriptor);
+    return client_socket_descriptor;
 }
 
 static std::optional<SocketDescriptor> CreateNativeSocket() {
@@ -113,6 +129,15 @@ static std::optional<SocketDescriptor> CreateNativeSocket() {
     return socket_descriptor;
 }
 
+Server::SetNonBlockingError Server::setNonBlocking() {
+    u_long mode = 1;
+    if (::ioctlsocket(socket_descriptor_, FIONBIO, &mode) == SOCKET_ERROR) {
+        return Server::SetNonBlockingError::kUnknown;
+    }
+
+    return Server::SetNonBlockingError::kOk;
+}
+
 static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
     ::closesocket(socket_descriptor);
 }
@@ -136,6 +161,15 @@ Server::BindError Server::bind(const Server::BindOptions& options) {
         return Server::BindError::kWrongAddress;
     }
 
+    if (options.reuse_port) {
+        int value = 1;
+        if (::setsockopt(socket_descriptor_, SOL_SOCKET, SO_REUSEPORT, &value,
+                         sizeof(value)) == kInvalidSocket) {
+            return errno == ENOPROTOOPT ? Server::BindError::kNotSupported
+                                        : Server::BindError::kUnknown;
+        }
+    }
+
     int bind_result = ::bind(socket_descriptor_,
                              reinterpret_cast<::sockaddr*>(&socket_address),
                              sizeof(socket_address));
@@ -169,6 +203,15 @@ Server::ListenError Server::listen(const Server::ListenOptions& options) {
 }
 
 std::unique_ptr<Socket> Server::accept(Server::AcceptError& error) {
+    SocketDescriptor client_socket_descriptor = acceptDescriptor(error);
+    if (error != Server::AcceptError::kOk) {
+        return nullptr;
+    }
+
+    return std::make_unique<Socket>(client_socket_descriptor);
+}
+
+SocketDescriptor Server::acceptDescriptor(Server::AcceptError& error) {
     assert(is_binded_);
     assert(is_listening_);
 
@@ -177,15 +220,17 @@ std::unique_ptr<Socket> Server::accept(Server::AcceptError& error) {
     if (client_socket_descriptor == kInvalidSocket) {
         if (errno == EINTR) {
             error = Server::AcceptError::kInterrupt;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            error = Server::AcceptError::kWouldBlock;
         } else {
             error = Server::AcceptError::kUnknown;
         }
 
-        return nullptr;
+        return client_socket_descriptor;
     }
 
     error = Server::AcceptError::kOk;
-    return std::make_unique<Socket>(client_socket_descriptor);
+    return client_socket_descriptor;
 }
 
 static std::optional<SocketDescriptor> CreateNativeSocket() {
@@ -198,6 +243,17 @@ static std::optional<SocketDescriptor> CreateNativeSocket() {
     return socket_descriptor;
 }
 
+Server::SetNonBlockingError Server::setNonBlocking() {
+    int flags = ::fcntl(socket_descriptor_, F_GETFL, 0);
+    if (flags == kInvalidSocket ||
+        ::fcntl(socket_descriptor_, F_SETFL, flags | O_NONBLOCK) ==
+            kInvalidSocket) {
+        return Server::SetNonBlockingError::kUnknown;
+    }
+
+    return Server::SetNonBlockingError::kOk;
+}
+
 static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
     ::close(socket_descriptor);
 }
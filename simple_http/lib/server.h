@@ -24,6 +24,9 @@ class Server {
     struct BindOptions {
         std::string address = "127.0.0.1";
         int port = 3000;
+        // Lets several sockets listen on the same address, the kernel
+        // spreads incoming connections between them (SO_REUSEPORT).
+        bool reuse_port = false;
     };
 
     enum class BindError {
@@ -32,6 +35,7 @@ class Server {
         kWrongAddress = 1,
         kAddressInUse = 2,
         kNoAccess = 3,
+        kNotSupported = 4,
     };
 
     struct ListenOptions {
@@ -47,6 +51,12 @@ class Server {
         kUnknown = -1,
         kOk = 0,
         kInterrupt = 1,
+        kWouldBlock = 2,
+    };
+
+    enum class SetNonBlockingError {
+        kUnknown = -1,
+        kOk = 0,
     };
 
     static std::unique_ptr<Server> createServer(CreateError& error);
@@ -61,6 +71,15 @@ class Server {
 
     std::unique_ptr<Socket> accept(AcceptError& error);
 
+    // Like accept(), but leaves creating the socket to the caller. Returns
+    // the invalid descriptor on errors.
+    SocketDescriptor acceptDescriptor(AcceptError& error);
+
+    // Makes accept() return kWouldBlock when no connection is pending.
+    SetNonBlockingError setNonBlocking();
+
+    SocketDescriptor getDescriptor() const { return socket_descriptor_; };
+
    private:
     Server(SocketDescriptor socket_descriptor)
         : socket_descriptor_(socket_descriptor) {}
@@ -0,0 +1,90 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace simple_http {
+
+// A vector keeping up to N elements inside itself, it allocates only when
+// more are added. Elements are copied bytewise.
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+   public:
+    SmallVector() = default;
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    SmallVector(SmallVector&& other) { *this = std::move(other); };
+
+    SmallVector& operator=(SmallVector&& other) {
+        if (this == &other) {
+            return *this;
+        }
+
+        heap_data_ = std::move(other.heap_data_);
+        capacity_ = other.capacity_;
+        size_ = other.size_;
+        if (!heap_data_) {
+            std::copy(other.inline_data_, other.inline_data_ + size_,
+                      inline_data_);
+        }
+
+        other.capacity_ = N;
+        other.size_ = 0;
+        return *this;
+    };
+
+    void push_back(const T& value) {
+        if (size_ == capacity_) {
+            grow();
+        }
+
+        data()[size_] = value;
+        size_++;
+    };
+
+    // Keeps the allocated memory.
+    void clear() { size_ = 0; };
+
+    size_t size() const { return size_; };
+
+    bool empty() const { return size_ == 0; };
+
+    T* data() { return heap_data_ ? heap_data_.get() : inline_data_; };
+    const T* data() const {
+        return heap_data_ ? heap_data_.get() : inline_data_;
+    };
+
+    T& operator[](size_t index) { return data()[index]; };
+    const T& operator[](size_t index) const { return data()[index]; };
+
+    T* begin() { return data(); };
+    T* end() { return data() + size_; };
+    const T* begin() const { return data(); };
+    const T* end() const { return data() + size_; };
+
+   private:
+    void grow() {
+        size_t capacity = capacity_ * 2;
+        std::unique_ptr<T[]> heap_data(new T[capacity]);
+        std::copy(data(), data() + size_, heap_data.get());
+        heap_data_ = std::move(heap_data);
+        capacity_ = capacity;
+    };
+
+    T inline_data_[N];
+    std::unique_ptr<T[]> heap_data_;
+    size_t capacity_ = N;
+    size_t size_ = 0;
+};
+
+}  // namespace simple_http
@@ -4,9 +4,12 @@
 
 #include "socket.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 
+#include "file.h"
 #include "socket_descriptor.h"
 
 #ifdef _WIN32
@@ -16,23 +19,78 @@
 #elif __linux__
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #endif
 
+#undef min
+
 namespace simple_http {
 
+// Socket timeouts use zero for no limit, poll() takes a negative value.
+static std::chrono::milliseconds GetWaitTimeout(
+    std::chrono::milliseconds timeout) {
+    return timeout.count() == 0 ? std::chrono::milliseconds(-1) : timeout;
+}
+
+// Buffers gathered into one system call.
+constexpr size_t kMaxSendBuffers = 64;
+
+// Skips the sent bytes, returns the number of buffers left.
+static size_t AdvanceSendBuffers(Socket::SendBuffer*& buffers,
+                                 size_t buffers_count, size_t sent_bytes) {
+    while (buffers_count != 0 &&
+           (sent_bytes != 0 || buffers->length == 0)) {
+        size_t skipped_bytes = std::min(sent_bytes, buffers->length);
+        buffers->data += skipped_bytes;
+        buffers->length -= skipped_bytes;
+        sent_bytes -= skipped_bytes;
+        if (buffers->length == 0) {
+            buffers++;
+            buffers_count--;
+        }
+    }
+
+    return buffers_count;
+}
+
 #ifdef _WIN32
 
+static Socket::WaitError WaitNativeSocket(SocketDescriptor socket_descriptor,
+                                          short events,
+                                          std::chrono::milliseconds timeout) {
+    ::WSAPOLLFD poll_descriptor;
+    poll_descriptor.fd = socket_descriptor;
+    poll_descriptor.events = events;
+    poll_descriptor.revents = 0;
+    int result =
+        ::WSAPoll(&poll_descriptor, 1, static_cast<INT>(timeout.count()));
+    if (result == SOCKET_ERROR) {
+        return Socket::WaitError::kUnknown;
+    }
+
+    if (result == 0) {
+        return Socket::WaitError::kTimeout;
+    }
+
+    return Socket::WaitError::kOk;
+}
+
 size_t Socket::read(char* buffer, size_t buffer_length,
                     Socket::ReadError& error) {
     int request_bytes_count =
         ::recv(socket_descriptor_, buffer, static_cast<int>(buffer_length), 0);
     if (request_bytes_count == SOCKET_ERROR) {
         int inner_error = ::WSAGetLastError();
-        if (inner_error == WSAETIMEDOUT) {
+        if (inner_error == WSAEWOULDBLOCK && is_non_blocking_) {
+            error = Socket::ReadError::kWouldBlock;
+        } else if (inner_error == WSAETIMEDOUT) {
             error = Socket::ReadError::kTimeout;
         } else {
             error = Socket::ReadError::kUnknown;
@@ -46,33 +104,140 @@ size_t Socket::read(char* buffer, size_t buffer_length,
 }
 
 Socket::SendError Socket::send(const char* data, size_t length) {
+    while (length != 0) {
+        int result =
+            ::send(socket_descriptor_, data, static_cast<int>(length), 0);
+        if (result == SOCKET_ERROR) {
+            int inner_error = ::WSAGetLastError();
+            if (inner_error == WSAEWOULDBLOCK && is_non_blocking_) {
+                if (waitWritable() != Socket::WaitError::kOk) {
+                    return Socket::SendError::kTimeout;
+                }
+
+                continue;
+            }
+
+            if (inner_error == WSAETIMEDOUT) {
+                return Socket::SendError::kTimeout;
+            }
+
+            return Socket::SendError::kUnknown;
+        }
+
+        data += result;
+        length -= static_cast<size_t>(result);
+    }
+
+    return Socket::SendError::kOk;
+}
+
+size_t Socket::trySend(const char* data, size_t length,
+                       Socket::SendError& error) {
     int result = ::send(socket_descriptor_, data, static_cast<int>(length), 0);
     if (result == SOCKET_ERROR) {
         int inner_error = ::WSAGetLastError();
-        if (inner_error == WSAETIMEDOUT) {
-            return Socket::SendError::kTimeout;
+        if (inner_error == WSAEWOULDBLOCK || inner_error == WSAETIMEDOUT) {
+            error = Socket::SendError::kTimeout;
+        } else {
+            error = Socket::SendError::kUnknown;
+        }
+
+        return 0;
+    }
+
+    error = Socket::SendError::kOk;
+    return static_cast<size_t>(result);
+}
+
+Socket::SendError Socket::send(Socket::SendBuffer* buffers,
+                               size_t buffers_count) {
+    buffers_count = AdvanceSendBuffers(buffers, buffers_count, 0);
+    while (buffers_count != 0) {
+        ::WSABUF native_buffers[kMaxSendBuffers];
+        DWORD native_buffers_count = static_cast<DWORD>(
+            std::min(buffers_count, kMaxSendBuffers));
+        for (DWORD i = 0; i < native_buffers_count; i++) {
+            native_buffers[i].buf = const_cast<char*>(buffers[i].data);
+            native_buffers[i].len = static_cast<ULONG>(buffers[i].length);
+        }
+
+        DWORD sent_bytes = 0;
+        int result = ::WSASend(socket_descriptor_, native_buffers,
+                               native_buffers_count, &sent_bytes, 0, nullptr,
+                               nullptr);
+        if (result == SOCKET_ERROR) {
+            int inner_error = ::WSAGetLastError();
+            if (inner_error == WSAEWOULDBLOCK && is_non_blocking_) {
+                if (waitWritable() != Socket::WaitError::kOk) {
+                    return Socket::SendError::kTimeout;
+                }
+
+                continue;
+            }
+
+            if (inner_error == WSAETIMEDOUT) {
+                return Socket::SendError::kTimeout;
+            }
+
+            return Socket::SendError::kUnknown;
         }
 
-        return Socket::SendError::kUnknown;
+        buffers_count = AdvanceSendBuffers(buffers, buffers_count,
+                                           static_cast<size_t>(sent_bytes));
     }
 
     return Socket::SendError::kOk;
 }
 
-Socket::SetTimeoutError Socket::setTimeout(std::chrono::milliseconds timeout) {
-    assert(timeout.count() >= 0);
+Socket::SendFileError Socket::sendFile(FileDescriptor file_descriptor,
+                                       uint64_t offset, size_t length) {
+    return sendFileBuffered(file_descriptor, offset, length);
+}
 
-    unsigned long milliseconds = static_cast<unsigned long>(timeout.count());
-    if (::setsockopt(socket_descriptor_, SOL_SOCKET, SO_RCVTIMEO,
-                     reinterpret_cast<const char*>(&timeout),
-                     sizeof(timeout)) == SOCKET_ERROR ||
-        ::setsockopt(socket_descriptor_, SOL_SOCKET, SO_SNDTIMEO,
-                     reinterpret_cast<const char*>(&timeout),
-                     sizeof(timeout)) == SOCKET_ERROR) {
-        return Socket::SetTimeoutError::kConnectionClosed;
+static bool SetNativeTimeout(SocketDescriptor socket_descriptor, int option,
+                             std::chrono::milliseconds timeout) {
+    DWORD milliseconds = static_cast<DWORD>(timeout.count());
+    return ::setsockopt(socket_descriptor, SOL_SOCKET, option,
+                        reinterpret_cast<const char*>(&milliseconds),
+                        sizeof(milliseconds)) != SOCKET_ERROR;
+}
+
+Socket::SetNonBlockingError Socket::setNonBlocking() {
+    u_long mode = 1;
+    if (::ioctlsocket(socket_descriptor_, FIONBIO, &mode) == SOCKET_ERROR) {
+        return Socket::SetNonBlockingError::kConnectionClosed;
     }
 
-    return Socket::SetTimeoutError::kOk;
+    is_non_blocking_ = true;
+    return Socket::SetNonBlockingError::kOk;
+}
+
+Socket::ShutdownError Socket::shutdownWrite() {
+    if (::shutdown(socket_descriptor_, SD_SEND) == SOCKET_ERROR) {
+        return Socket::ShutdownError::kConnectionClosed;
+    }
+
+    return Socket::ShutdownError::kOk;
+}
+
+Socket::WaitError Socket::waitReadable(std::chrono::milliseconds timeout) {
+    assert(timeout.count() >= 0);
+    return WaitNativeSocket(socket_descriptor_, POLLRDNORM, timeout);
+}
+
+Socket::WaitError Socket::waitReadable() {
+    return WaitNativeSocket(socket_descriptor_, POLLRDNORM,
+                            GetWaitTimeout(read_timeout_));
+}
+
+Socket::WaitError Socket::waitWritable(std::chrono::milliseconds timeout) {
+    assert(timeout.count() >= 0);
+    return WaitNativeSocket(socket_descriptor_, POLLWRNORM, timeout);
+}
+
+Socket::WaitError Socket::waitWritable() {
+    return WaitNativeSocket(socket_descriptor_, POLLWRNORM,
+                            GetWaitTimeout(write_timeout_));
 }
 
 static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
@@ -83,12 +248,43 @@ static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
 
 constexpr int kInvalidSocket = -1;
 
+static Socket::WaitError WaitNativeSocket(SocketDescriptor socket_descriptor,
+                                          short events,
+                                          std::chrono::milliseconds timeout) {
+    ::pollfd poll_descriptor;
+    poll_descriptor.fd = socket_descriptor;
+    poll_descriptor.events = events;
+    poll_descriptor.revents = 0;
+    int poll_timeout = static_cast<int>(timeout.count());
+    int result;
+    do {
+        result = ::poll(&poll_descriptor, 1, poll_timeout);
+    } while (result == kInvalidSocket && errno == EINTR);
+
+    if (result == kInvalidSocket) {
+        return Socket::WaitError::kUnknown;
+    }
+
+    if (result == 0) {
+        return Socket::WaitError::kTimeout;
+    }
+
+    return Socket::WaitError::kOk;
+}
+
 size_t Socket::read(char* buffer, size_t buffer_length,
                     Socket::ReadError& error) {
-    int request_bytes_count =
-        ::recv(socket_descriptor_, buffer, static_cast<int>(buffer_length), 0);
+    ssize_t request_bytes_count;
+    do {
+        request_bytes_count =
+            ::recv(socket_descriptor_, buffer, buffer_length, 0);
+    } while (request_bytes_count == kInvalidSocket && errno == EINTR);
+
     if (request_bytes_count == kInvalidSocket) {
-        if (errno == ETIMEDOUT) {
+        if ((errno == EAGAIN || errno == EWOULDBLOCK) && is_non_blocking_) {
+            error = Socket::ReadError::kWouldBlock;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK ||
+                   errno == ETIMEDOUT) {
             error = Socket::ReadError::kTimeout;
         } else {
             error = Socket::ReadError::kUnknown;
@@ -102,21 +298,148 @@ size_t Socket::read(char* buffer, size_t buffer_length,
 }
 
 Socket::SendError Socket::send(const char* data, size_t length) {
-    int result = ::send(socket_descriptor_, data, static_cast<int>(length), 0);
+    while (length != 0) {
+        ssize_t result = ::send(socket_descriptor_, data, length, MSG_NOSIGNAL);
+        if (result == kInvalidSocket) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && is_non_blocking_) {
+                if (waitWritable() != Socket::WaitError::kOk) {
+                    return Socket::SendError::kTimeout;
+                }
+
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT) {
+                return Socket::SendError::kTimeout;
+            }
+
+            return Socket::SendError::kUnknown;
+        }
+
+        data += result;
+        length -= static_cast<size_t>(result);
+    }
+
+    return Socket::SendError::kOk;
+}
+
+size_t Socket::trySend(const char* data, size_t length,
+                       Socket::SendError& error) {
+    ssize_t result;
+    do {
+        result = ::send(socket_descriptor_, data, length,
+                        MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (result == kInvalidSocket && errno == EINTR);
+
     if (result == kInvalidSocket) {
-        if (errno == ETIMEDOUT) {
-            return Socket::SendError::kTimeout;
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT) {
+            error = Socket::SendError::kTimeout;
+        } else {
+            error = Socket::SendError::kUnknown;
+        }
+
+        return 0;
+    }
+
+    error = Socket::SendError::kOk;
+    return static_cast<size_t>(result);
+}
+
+Socket::SendError Socket::send(Socket::SendBuffer* buffers,
+                               size_t buffers_count) {
+    buffers_count = AdvanceSendBuffers(buffers, buffers_count, 0);
+    while (buffers_count != 0) {
+        ::iovec native_buffers[kMaxSendBuffers];
+        size_t native_buffers_count = std::min(buffers_count, kMaxSendBuffers);
+        for (size_t i = 0; i < native_buffers_count; i++) {
+            native_buffers[i].iov_base = const_cast<char*>(buffers[i].data);
+            native_buffers[i].iov_len = buffers[i].length;
         }
 
-        return Socket::SendError::kUnknown;
+        // sendmsg() rather than writev() to pass MSG_NOSIGNAL.
+        ::msghdr message = {};
+        message.msg_iov = native_buffers;
+        message.msg_iovlen = native_buffers_count;
+        ssize_t result = ::sendmsg(socket_descriptor_, &message, MSG_NOSIGNAL);
+        if (result == kInvalidSocket) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && is_non_blocking_) {
+                if (waitWritable() != Socket::WaitError::kOk) {
+                    return Socket::SendError::kTimeout;
+                }
+
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT) {
+                return Socket::SendError::kTimeout;
+            }
+
+            return Socket::SendError::kUnknown;
+        }
+
+        buffers_count = AdvanceSendBuffers(buffers, buffers_count,
+                                           static_cast<size_t>(result));
     }
 
     return Socket::SendError::kOk;
 }
 
-Socket::SetTimeoutError Socket::setTimeout(std::chrono::milliseconds timeout) {
-    assert(timeout.count() >= 0);
+Socket::SendFileError Socket::sendFile(FileDescriptor file_descriptor,
+                                       uint64_t offset, size_t length) {
+    off_t file_offset = static_cast<off_t>(offset);
+    bool is_started = false;
+    while (length != 0) {
+        ssize_t result =
+            ::sendfile(socket_descriptor_, file_descriptor, &file_offset,
+                       length);
+        if (result == kInvalidSocket) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && is_non_blocking_) {
+                if (waitWritable() != Socket::WaitError::kOk) {
+                    return Socket::SendFileError::kTimeout;
+                }
+
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT) {
+                return Socket::SendFileError::kTimeout;
+            }
+
+            // The file does not support sendfile.
+            if ((errno == EINVAL || errno == ENOSYS) && !is_started) {
+                return sendFileBuffered(file_descriptor, offset, length);
+            }
+
+            return errno == EIO ? Socket::SendFileError::kFileError
+                                : Socket::SendFileError::kUnknown;
+        }
+
+        // The file got shorter.
+        if (result == 0) {
+            return Socket::SendFileError::kFileError;
+        }
+
+        is_started = true;
+        length -= static_cast<size_t>(result);
+    }
+
+    return Socket::SendFileError::kOk;
+}
 
+static bool SetNativeTimeout(SocketDescriptor socket_descriptor, int option,
+                             std::chrono::milliseconds timeout) {
     timeval native_timeout;
     {
         using namespace std::chrono;
@@ -124,16 +447,49 @@ Socket::SetTimeoutError Socket::setTimeout(std::chrono::milliseconds timeout) {
         native_timeout.tv_usec =
             duration_cast<microseconds>(timeout % seconds(1)).count();
     }
-    if (::setsockopt(socket_descriptor_, SOL_SOCKET, SO_RCVTIMEO,
-                     reinterpret_cast<const char*>(&native_timeout),
-                     sizeof(native_timeout)) == kInvalidSocket ||
-        ::setsockopt(socket_descriptor_, SOL_SOCKET, SO_SNDTIMEO,
-                     reinterpret_cast<const char*>(&native_timeout),
-                     sizeof(native_timeout)) == kInvalidSocket) {
-        return Socket::SetTimeoutError::kConnectionClosed;
+    return ::setsockopt(socket_descriptor, SOL_SOCKET, option,
+                        reinterpret_cast<const char*>(&native_timeout),
+                        sizeof(native_timeout)) != kInvalidSocket;
+}
+
+Socket::SetNonBlockingError Socket::setNonBlocking() {
+    int flags = ::fcntl(socket_descriptor_, F_GETFL, 0);
+    if (flags == kInvalidSocket ||
+        ::fcntl(socket_descriptor_, F_SETFL, flags | O_NONBLOCK) ==
+            kInvalidSocket) {
+        return Socket::SetNonBlockingError::kConnectionClosed;
     }
 
-    return Socket::SetTimeoutError::kOk;
+    is_non_blocking_ = true;
+    return Socket::SetNonBlockingError::kOk;
+}
+
+Socket::ShutdownError Socket::shutdownWrite() {
+    if (::shutdown(socket_descriptor_, SHUT_WR) == kInvalidSocket) {
+        return Socket::ShutdownError::kConnectionClosed;
+    }
+
+    return Socket::ShutdownError::kOk;
+}
+
+Socket::WaitError Socket::waitReadable(std::chrono::milliseconds timeout) {
+    assert(timeout.count() >= 0);
+    return WaitNativeSocket(socket_descriptor_, POLLIN, timeout);
+}
+
+Socket::WaitError Socket::waitReadable() {
+    return WaitNativeSocket(socket_descriptor_, POLLIN,
+                            GetWaitTimeout(read_timeout_));
+}
+
+Socket::WaitError Socket::waitWritable(std::chrono::milliseconds timeout) {
+    assert(timeout.count() >= 0);
+    return WaitNativeSocket(socket_descriptor_, POLLOUT, timeout);
+}
+
+Socket::WaitError Socket::waitWritable() {
+    return WaitNativeSocket(socket_descriptor_, POLLOUT,
+                            GetWaitTimeout(write_timeout_));
 }
 
 static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
@@ -142,6 +498,63 @@ static void CloseNativeSocket(SocketDescriptor socket_descriptor) {
 
 #endif
 
+Socket::SendFileError Socket::sendFileBuffered(FileDescriptor file_descriptor,
+                                               uint64_t offset,
+                                               size_t length) {
+    char buffer[65536];
+    while (length != 0) {
+        File::ReadError read_error;
+        size_t bytes_count =
+            File::read(file_descriptor, buffer,
+                       std::min(length, sizeof(buffer)), offset, read_error);
+        if (read_error != File::ReadError::kOk || bytes_count == 0) {
+            return Socket::SendFileError::kFileError;
+        }
+
+        Socket::SendError send_error = send(buffer, bytes_count);
+        if (send_error != Socket::SendError::kOk) {
+            return send_error == Socket::SendError::kTimeout
+                       ? Socket::SendFileError::kTimeout
+                       : Socket::SendFileError::kUnknown;
+        }
+
+        offset += bytes_count;
+        length -= bytes_count;
+    }
+
+    return Socket::SendFileError::kOk;
+}
+
+Socket::SetTimeoutError Socket::setTimeout(std::chrono::milliseconds timeout) {
+    return setTimeouts(timeout, timeout);
+}
+
+Socket::SetTimeoutError Socket::setTimeouts(
+    std::chrono::milliseconds read_timeout,
+    std::chrono::milliseconds write_timeout) {
+    assert(read_timeout.count() >= 0);
+    assert(write_timeout.count() >= 0);
+
+    // Blocking sockets start without timeouts, unchanged ones cost no
+    // system calls.
+    bool is_set = true;
+    if (!is_non_blocking_ && read_timeout != read_timeout_) {
+        is_set = SetNativeTimeout(socket_descriptor_, SO_RCVTIMEO,
+                                  read_timeout);
+    }
+    if (is_set && !is_non_blocking_ && write_timeout != write_timeout_) {
+        is_set = SetNativeTimeout(socket_descriptor_, SO_SNDTIMEO,
+                                  write_timeout);
+    }
+    if (!is_set) {
+        return Socket::SetTimeoutError::kConnectionClosed;
+    }
+
+    read_timeout_ = read_timeout;
+    write_timeout_ = write_timeout;
+    return Socket::SetTimeoutError::kOk;
+}
+
 void Socket::close() {
     if (is_closed_) {
         return;
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
+#include "file.h"
 #include "socket_descriptor.h"
 
 namespace simple_http {
@@ -16,6 +18,7 @@ class Socket {
         kUnknown = -1,
         kOk = 0,
         kTimeout = 1,
+        kWouldBlock = 2,
     };
 
     enum class SendError {
@@ -24,29 +27,114 @@ class Socket {
         kTimeout = 1,
     };
 
+    enum class SendFileError {
+        kUnknown = -1,
+        kOk = 0,
+        kTimeout = 1,
+        kFileError = 2,
+    };
+
     enum class SetTimeoutError {
         kOk = 0,
         kConnectionClosed = 1,
     };
 
+    enum class SetNonBlockingError {
+        kOk = 0,
+        kConnectionClosed = 1,
+    };
+
+    enum class ShutdownError {
+        kOk = 0,
+        kConnectionClosed = 1,
+    };
+
+    enum class WaitError {
+        kUnknown = -1,
+        kOk = 0,
+        kTimeout = 1,
+    };
+
+    // A part of the data given to send() at once.
+    struct SendBuffer {
+        const char* data = nullptr;
+        size_t length = 0;
+    };
+
     Socket() = delete;
     Socket(SocketDescriptor socket_descriptor)
         : socket_descriptor_(socket_descriptor) {}
 
     ~Socket() { close(); };
 
+    // On a non-blocking socket returns kWouldBlock instead of waiting for
+    // data.
     size_t read(char* buffer, size_t buffer_length, ReadError& error);
 
+    // Sends all the data. On a non-blocking socket waits up to the timeout
+    // whenever the send buffer is full.
     SendError send(const char* data, size_t length);
 
+    // Sends what fits into the send buffer without waiting, returns the
+    // number of bytes sent, kTimeout when nothing fits. On Windows the
+    // socket must be non-blocking.
+    size_t trySend(const char* data, size_t length, SendError& error);
+
+    // Sends all the buffers in order, gathering them into as few system
+    // calls as possible. The buffers are advanced past the sent data.
+    SendError send(SendBuffer* buffers, size_t buffers_count);
+
+    // Sends length bytes of a file starting at offset. The kernel copies
+    // them directly (sendfile) where possible, otherwise they are read
+    // into a buffer first.
+    SendFileError sendFile(FileDescriptor file_descriptor, uint64_t offset,
+                           size_t length);
+
+    // Blocking sockets get the timeouts as SO_RCVTIMEO/SO_SNDTIMEO,
+    // non-blocking ones use them for waiting in send() and by readers.
     SetTimeoutError setTimeout(std::chrono::milliseconds timeout);
+    SetTimeoutError setTimeouts(std::chrono::milliseconds read_timeout,
+                                std::chrono::milliseconds write_timeout);
+
+    SetNonBlockingError setNonBlocking();
+
+    // Sends FIN after the data already sent, reading stays possible.
+    ShutdownError shutdownWrite();
+
+    // Blocks until the socket has data to read (or the peer closed it).
+    // A zero timeout only checks the current state.
+    WaitError waitReadable(std::chrono::milliseconds timeout);
+
+    // Waits up to the read timeout, without limit when it is zero.
+    WaitError waitReadable();
+
+    WaitError waitWritable(std::chrono::milliseconds timeout);
+
+    // Waits up to the write timeout, without limit when it is zero.
+    WaitError waitWritable();
+
+    std::chrono::milliseconds getReadTimeout() const { return read_timeout_; };
+
+    std::chrono::milliseconds getWriteTimeout() const {
+        return write_timeout_;
+    };
+
+    SocketDescriptor getDescriptor() const { return socket_descriptor_; };
+
+    bool isNonBlocking() const { return is_non_blocking_; };
 
     bool isClosed() { return is_closed_; };
 
     void close();
 
    private:
+    SendFileError sendFileBuffered(FileDescriptor file_descriptor,
+                                   uint64_t offset, size_t length);
+
     SocketDescriptor socket_descriptor_;
+    std::chrono::milliseconds read_timeout_ = std::chrono::milliseconds(0);
+    std::chrono::milliseconds write_timeout_ = std::chrono::milliseconds(0);
+    bool is_non_blocking_ = false;
     bool is_closed_ = false;
 };
 
@@ -6,22 +6,77 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 
 #include "socket.h"
 
+#undef min
+
 namespace simple_http {
 
 SocketReader::ReadResult SocketReader::read(SocketReader::ReadError& error) {
+    char* data = buffer_ + pinned_bytes_;
     if (!is_examined_ || is_completed_) {
         error = SocketReader::ReadError::kOk;
-        return SocketReader::ReadResult(buffer_, received_bytes_,
-                                        is_completed_);
+        return SocketReader::ReadResult(data, received_bytes_, is_completed_);
+    }
+
+    size_t free_bytes = buffer_length_ - pinned_bytes_ - received_bytes_;
+    if (has_received_data_) {
+        size_t bytes_count = std::min(received_data_length_, free_bytes);
+        std::copy(received_data_, received_data_ + bytes_count,
+                  data + received_bytes_);
+        received_data_ += bytes_count;
+        received_data_length_ -= bytes_count;
+        if (received_data_length_ == 0) {
+            clearReceivedData();
+        }
+
+        received_bytes_ += bytes_count;
+        is_completed_ = bytes_count == 0;
+        error = SocketReader::ReadError::kOk;
+        return SocketReader::ReadResult(data, received_bytes_, is_completed_);
     }
 
     Socket::ReadError read_error;
-    size_t bytes_count =
-        socket_->read(buffer_ + received_bytes_,
-                      buffer_length_ - received_bytes_, read_error);
+    size_t bytes_count;
+    while (true) {
+        bool is_limited;
+        std::chrono::milliseconds timeout = getWaitTimeout(is_limited);
+        if (is_limited && timeout.count() < 0 && !is_suspendable_) {
+            return failTimedOut(error);
+        }
+
+        // A blocking read may wait up to the socket timeout, so a nearer
+        // deadline is waited for beforehand.
+        if (is_limited && !socket_->isNonBlocking() &&
+            socket_->waitReadable(timeout) == Socket::WaitError::kTimeout) {
+            return failTimedOut(error);
+        }
+
+        bytes_count =
+            socket_->read(data + received_bytes_, free_bytes, read_error);
+        if (read_error != Socket::ReadError::kWouldBlock) {
+            break;
+        }
+
+        if (is_suspendable_) {
+            error = SocketReader::ReadError::kWouldBlock;
+            return SocketReader::ReadResult();
+        }
+
+        Socket::WaitError wait_error =
+            is_limited ? socket_->waitReadable(timeout)
+                       : socket_->waitReadable();
+        if (wait_error == Socket::WaitError::kTimeout && is_limited) {
+            return failTimedOut(error);
+        }
+
+        if (wait_error != Socket::WaitError::kOk) {
+            break;
+        }
+    }
+
     if (read_error != Socket::ReadError::kOk) {
         socket_->close();
         error = SocketReader::ReadError::kConnectionClosed;
@@ -31,7 +86,46 @@ SocketReader::ReadResult SocketReader::read(SocketReader::ReadError& error) {
     received_bytes_ += bytes_count;
     is_completed_ = bytes_count == 0;
     error = SocketReader::ReadError::kOk;
-    return SocketReader::ReadResult(buffer_, received_bytes_, is_completed_);
+    return SocketReader::ReadResult(data, received_bytes_, is_completed_);
+}
+
+std::chrono::milliseconds SocketReader::getWaitTimeout(bool& is_limited) const {
+    using namespace std::chrono;
+
+    milliseconds timeout = socket_->getReadTimeout();
+    is_limited = false;
+    if (deadline_ == steady_clock::time_point::max()) {
+        return timeout;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    if (now >= deadline_) {
+        is_limited = true;
+        return milliseconds(-1);
+    }
+
+    milliseconds remaining = ceil<milliseconds>(deadline_ - now);
+    if (timeout.count() == 0 || remaining < timeout) {
+        is_limited = true;
+        return remaining;
+    }
+
+    return timeout;
+}
+
+SocketReader::ReadResult SocketReader::failTimedOut(ReadError& error) {
+    is_timed_out_ = true;
+    error = SocketReader::ReadError::kTimedOut;
+    return SocketReader::ReadResult();
+}
+
+void SocketReader::setBuffer(char* buffer, size_t buffer_length) {
+    assert(received_bytes_ <= buffer_length);
+    assert(pinned_bytes_ == 0);
+
+    std::copy(buffer_, buffer_ + received_bytes_, buffer);
+    buffer_ = buffer;
+    buffer_length_ = buffer_length;
 }
 
 void SocketReader::advance(size_t consumed_bytes) {
@@ -43,9 +137,30 @@ void SocketReader::advance(size_t consumed_bytes, size_t examined_bytes) {
     assert(examined_bytes >= 0 && examined_bytes <= received_bytes_);
     assert(consumed_bytes <= examined_bytes);
 
-    std::copy(buffer_ + consumed_bytes, buffer_ + received_bytes_, buffer_);
+    char* data = buffer_ + pinned_bytes_;
+    if (consumed_bytes != 0) {
+        std::copy(data + consumed_bytes, data + received_bytes_, data);
+    }
     is_examined_ = examined_bytes == received_bytes_;
     received_bytes_ -= consumed_bytes;
 }
 
+void SocketReader::pin(size_t consumed_bytes) {
+    assert(consumed_bytes <= received_bytes_);
+
+    is_examined_ = consumed_bytes == received_bytes_;
+    pinned_bytes_ += consumed_bytes;
+    received_bytes_ -= consumed_bytes;
+}
+
+void SocketReader::unpin() {
+    if (pinned_bytes_ == 0) {
+        return;
+    }
+
+    std::copy(buffer_ + pinned_bytes_,
+              buffer_ + pinned_bytes_ + received_bytes_, buffer_);
+    pinned_bytes_ = 0;
+}
+
 }  // namespace simple_http
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <chrono>
+
 #include "socket.h"
 
 namespace simple_http {
@@ -32,6 +34,8 @@ class SocketReader {
     enum class ReadError {
         kOk = 0,
         kConnectionClosed = 1,
+        kWouldBlock = 2,
+        kTimedOut = 3,
     };
 
     SocketReader() = delete;
@@ -41,17 +45,88 @@ class SocketReader {
 
     ReadResult read(ReadError& error);
 
+    // Returns the bytes already received without touching the socket.
+    ReadResult peek() const {
+        return ReadResult(buffer_ + pinned_bytes_, received_bytes_,
+                          is_completed_);
+    };
+
     void advance(size_t consumed_bytes, size_t examined_bytes);
     void advance(size_t consumed_bytes);
 
+    bool hasBufferedData() const { return received_bytes_ != 0; };
+
+    // Whether the buffer has no room for more data.
+    bool isFull() const {
+        return pinned_bytes_ + received_bytes_ == buffer_length_;
+    };
+
+    // Consumes bytes like advance(), but keeps them at their place in the
+    // buffer until unpin(). The following data is read after them.
+    void pin(size_t consumed_bytes);
+
+    void unpin();
+
+    // Moves the buffered bytes to another buffer, which must fit them.
+    void setBuffer(char* buffer, size_t buffer_length);
+
+    // A suspendable reader of a non-blocking socket returns kWouldBlock when
+    // no data is available. Otherwise it waits for data up to the socket
+    // timeout.
+    void setSuspendable(bool is_suspendable) {
+        is_suspendable_ = is_suspendable;
+    };
+
+    // Gives data already received from the socket by someone else, it is
+    // read before the socket. Empty data means the connection was closed.
+    // The data must stay valid until it is read or cleared.
+    void setReceivedData(const char* data, size_t length) {
+        received_data_ = data;
+        received_data_length_ = length;
+        has_received_data_ = true;
+    };
+
+    void clearReceivedData() {
+        received_data_ = nullptr;
+        received_data_length_ = 0;
+        has_received_data_ = false;
+    };
+
+    // Waiting reads fail with kTimedOut once the deadline passes, unlike the
+    // socket timeout it does not restart with every received byte. max()
+    // means no deadline.
+    void setDeadline(std::chrono::steady_clock::time_point deadline) {
+        deadline_ = deadline;
+        is_timed_out_ = false;
+    };
+
+    // Whether a read failed because of the deadline.
+    bool isTimedOut() const { return is_timed_out_; };
+
    private:
+    // The socket timeout, or the time left till the deadline when it is
+    // nearer. Sets is_limited when it is the deadline.
+    std::chrono::milliseconds getWaitTimeout(bool& is_limited) const;
+
+    ReadResult failTimedOut(ReadError& error);
+
     Socket* socket_ = nullptr;
     char* buffer_ = nullptr;
     size_t buffer_length_ = 0;
 
     bool is_completed_ = false;
     bool is_examined_ = true;
+    bool is_suspendable_ = false;
     size_t received_bytes_ = 0;
+    size_t pinned_bytes_ = 0;
+
+    const char* received_data_ = nullptr;
+    size_t received_data_length_ = 0;
+    bool has_received_data_ = false;
+
+    std::chrono::steady_clock::time_point deadline_ =
+        std::chrono::steady_clock::time_point::max();
+    bool is_timed_out_ = false;
 };
 
 }  // namespace simple_http
@@ -6,8 +6,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <string>
 
+#include "file.h"
 #include "socket.h"
 
 #undef min
@@ -22,26 +24,72 @@ SocketWriter::WriteError SocketWriter::write(const char* source_buffer,
                                              size_t source_buffer_length) {
     assert(source_buffer_length >= 0);
 
-    do {
-        size_t bytes_to_copy =
-            std::min(buffer_length_ - saved_bytes_, source_buffer_length);
-        const char* source_start = source_buffer;
-        const char* source_end = source_buffer + bytes_to_copy;
-        char* destination_start = buffer_ + saved_bytes_;
+    if (source_buffer_length >= kDirectWriteLength ||
+        source_buffer_length > buffer_length_ - saved_bytes_) {
+        Socket::SendBuffer buffers[2];
+        buffers[0].data = buffer_;
+        buffers[0].length = saved_bytes_;
+        buffers[1].data = source_buffer;
+        buffers[1].length = source_buffer_length;
+
+        Socket::SendError send_error = socket_->send(buffers, 2);
+        if (send_error != Socket::SendError::kOk) {
+            socket_->close();
+            return SocketWriter::WriteError::kConnectionClosed;
+        }
+
+        saved_bytes_ = 0;
+        return SocketWriter::WriteError::kOk;
+    }
 
-        std::copy(source_start, source_end, destination_start);
+    std::copy(source_buffer, source_buffer + source_buffer_length,
+              buffer_ + saved_bytes_);
+    saved_bytes_ += source_buffer_length;
 
-        saved_bytes_ += bytes_to_copy;
-        source_buffer_length -= bytes_to_copy;
-        source_buffer += bytes_to_copy;
+    if (saved_bytes_ == buffer_length_) {
+        SocketWriter::FlushError flush_error = flush();
+        if (flush_error != SocketWriter::FlushError::kOk) {
+            return SocketWriter::WriteError::kConnectionClosed;
+        }
+    }
 
-        if (saved_bytes_ == buffer_length_) {
-            SocketWriter::FlushError flush_error = flush();
-            if (flush_error != SocketWriter::FlushError::kOk) {
-                return SocketWriter::WriteError::kConnectionClosed;
+    return SocketWriter::WriteError::kOk;
+}
+
+SocketWriter::WriteError SocketWriter::writeFile(
+    FileDescriptor file_descriptor, uint64_t offset, size_t length) {
+    if (length <= buffer_length_ - saved_bytes_) {
+        while (length != 0) {
+            File::ReadError read_error;
+            size_t bytes_count =
+                File::read(file_descriptor, buffer_ + saved_bytes_, length,
+                           offset, read_error);
+            if (read_error != File::ReadError::kOk || bytes_count == 0) {
+                saved_bytes_ = 0;
+                socket_->close();
+                return SocketWriter::WriteError::kFileError;
             }
+
+            saved_bytes_ += bytes_count;
+            offset += bytes_count;
+            length -= bytes_count;
         }
-    } while (source_buffer_length != 0);
+
+        return SocketWriter::WriteError::kOk;
+    }
+
+    if (flush() != SocketWriter::FlushError::kOk) {
+        return SocketWriter::WriteError::kConnectionClosed;
+    }
+
+    Socket::SendFileError send_error =
+        socket_->sendFile(file_descriptor, offset, length);
+    if (send_error != Socket::SendFileError::kOk) {
+        socket_->close();
+        return send_error == Socket::SendFileError::kFileError
+                   ? SocketWriter::WriteError::kFileError
+                   : SocketWriter::WriteError::kConnectionClosed;
+    }
 
     return SocketWriter::WriteError::kOk;
 }
@@ -51,13 +99,14 @@ SocketWriter::FlushError SocketWriter::flush() {
         return SocketWriter::FlushError::kOk;
     }
 
+    // Bytes not sent are dropped either way, the connection is closed.
     Socket::SendError send_error = socket_->send(buffer_, saved_bytes_);
+    saved_bytes_ = 0;
     if (send_error != Socket::SendError::kOk) {
         socket_->close();
         return SocketWriter::FlushError::kConnectionClosed;
     }
 
-    saved_bytes_ = 0;
     return SocketWriter::FlushError::kOk;
 }
 
@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdint>
 #include <string>
 
+#include "file.h"
 #include "socket.h"
 
 namespace simple_http {
@@ -15,6 +18,7 @@ class SocketWriter {
     enum class WriteError {
         kOk = 0,
         kConnectionClosed = 1,
+        kFileError = 2,
     };
 
     enum class FlushError {
@@ -22,16 +26,39 @@ class SocketWriter {
         kConnectionClosed = 1,
     };
 
+    static constexpr size_t kDirectWriteLength = 16384;
+
     SocketWriter() = delete;
 
     SocketWriter(Socket* socket, char* buffer, size_t buffer_length)
         : socket_(socket), buffer_(buffer), buffer_length_(buffer_length){};
 
     WriteError write(const std::string& value);
+
+    // Data from kDirectWriteLength bytes, or not fitting into the buffer,
+    // is not copied: it is sent right away together with the buffered
+    // bytes in one system call.
     WriteError write(const char* source_buffer, size_t source_buffer_length);
 
+    // Writes a part of a file. A part fitting into the buffer is read into
+    // it, a larger one goes to the socket directly after the buffered
+    // bytes. Any error closes the connection, since the response is broken.
+    WriteError writeFile(FileDescriptor file_descriptor, uint64_t offset,
+                         size_t length);
+
+    // Buffered bytes are dropped when sending fails.
     FlushError flush();
 
+    // Drops the buffered bytes, for a connection that is already closed.
+    void discard() { saved_bytes_ = 0; };
+
+    // Switches to another buffer. Allowed only when nothing is buffered.
+    void setBuffer(char* buffer, size_t buffer_length) {
+        assert(saved_bytes_ == 0);
+        buffer_ = buffer;
+        buffer_length_ = buffer_length;
+    };
+
    private:
     Socket* socket_ = nullptr;
     char* buffer_ = nullptr;
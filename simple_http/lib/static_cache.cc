@@ -0,0 +1,139 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "static_cache.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file.h"
+
+namespace simple_http {
+
+StaticCache::StaticCache(const StaticCacheOptions& options)
+    : options_(options) {}
+
+std::shared_ptr<const StaticCache::Entry> StaticCache::find(
+    std::string_view key) {
+    std::shared_ptr<const Entry> entry;
+    {
+        std::shared_lock lock(mutex_);
+        auto iterator = nodes_.find(key);
+        if (iterator == nodes_.end()) {
+            return nullptr;
+        }
+
+        Node& node = iterator->second;
+        // Popular entries are not written to on every hit.
+        if (!node.is_referenced.load(std::memory_order_relaxed)) {
+            node.is_referenced.store(true, std::memory_order_relaxed);
+        }
+
+        if (node.entry->path.empty()) {
+            return node.entry;
+        }
+
+        Clock::time_point now = Clock::now();
+        Clock::rep valid_until =
+            node.valid_until.load(std::memory_order_relaxed);
+        if (now.time_since_epoch().count() < valid_until) {
+            return node.entry;
+        }
+
+        // Other lookups keep using the entry while this one checks the file.
+        Clock::rep following_check =
+            (now + options_.valid_time).time_since_epoch().count();
+        if (!node.valid_until.compare_exchange_strong(
+                valid_until, following_check, std::memory_order_relaxed)) {
+            return node.entry;
+        }
+
+        entry = node.entry;
+    }
+
+    File::OpenError error;
+    File::Status status = File::readStatus(entry->path, error);
+    if (error == File::OpenError::kOk && status == entry->status) {
+        return entry;
+    }
+
+    std::unique_lock lock(mutex_);
+    auto iterator = nodes_.find(key);
+    if (iterator != nodes_.end() && iterator->second.entry == entry) {
+        remove(&iterator->second);
+    }
+
+    return nullptr;
+}
+
+bool StaticCache::insert(std::string_view key,
+                         std::shared_ptr<const Entry> entry) {
+    size_t length = key.length() + entry->head.length() + entry->body.length();
+    if (length > options_.max_entry_length || length > options_.capacity) {
+        return false;
+    }
+
+    std::unique_lock lock(mutex_);
+    auto iterator = nodes_.find(key);
+    if (iterator != nodes_.end()) {
+        remove(&iterator->second);
+    }
+
+    evict(length);
+
+    auto [inserted, is_inserted] = nodes_.try_emplace(std::string(key));
+    Node& node = inserted->second;
+    node.entry = std::move(entry);
+    node.key = &inserted->first;
+    node.length = length;
+    node.valid_until.store(
+        (Clock::now() + options_.valid_time).time_since_epoch().count(),
+        std::memory_order_relaxed);
+    node.index = ring_.size();
+    ring_.push_back(&node);
+    length_ += length;
+    return true;
+}
+
+void StaticCache::clear() {
+    std::unique_lock lock(mutex_);
+    nodes_.clear();
+    ring_.clear();
+    hand_ = 0;
+    length_ = 0;
+}
+
+void StaticCache::evict(size_t length) {
+    while (length_ + length > options_.capacity && !ring_.empty()) {
+        if (hand_ >= ring_.size()) {
+            hand_ = 0;
+        }
+
+        Node* node = ring_[hand_];
+        if (node->is_referenced.exchange(false, std::memory_order_relaxed)) {
+            hand_++;
+            continue;
+        }
+
+        // The last node takes its place, so the hand stays.
+        remove(node);
+    }
+}
+
+void StaticCache::remove(Node* node) {
+    Node* last = ring_.back();
+    ring_[node->index] = last;
+    last->index = node->index;
+    ring_.pop_back();
+
+    length_ -= node->length;
+    nodes_.erase(nodes_.find(std::string_view(*node->key)));
+}
+
+}  // namespace simple_http
@@ -0,0 +1,105 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "file.h"
+
+namespace simple_http {
+
+struct StaticCacheOptions {
+    // Bytes of all the keys, heads and bodies together.
+    size_t capacity = 64 * 1024 * 1024;
+    // Larger entries are not kept.
+    size_t max_entry_length = 1024 * 1024;
+    // How long an entry read from a file is served without checking the
+    // file on the disk.
+    std::chrono::milliseconds valid_time = std::chrono::milliseconds(1000);
+};
+
+// Complete responses kept in memory by a key, e.g. the request path, within
+// a byte budget. Entries not used since the last pass of the clock hand are
+// evicted first (CLOCK), so a hit only marks the entry and takes no
+// exclusive lock. Once the valid time passes, the next lookup compares the
+// file of the entry with the disk and drops the entry if it changed.
+// Thread-safe.
+class StaticCache {
+   public:
+    // A response serialized beforehand, see
+    // OutgoingMessage::writeSerialized().
+    struct Entry {
+        std::string head;
+        std::string body;
+        // The file the response was read from, empty for other responses,
+        // which are never checked.
+        std::filesystem::path path;
+        File::Status status;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    explicit StaticCache(const StaticCacheOptions& options = {});
+
+    StaticCache(const StaticCache&) = delete;
+    StaticCache& operator=(const StaticCache&) = delete;
+
+    // Returns nullptr when the key is not cached or its file has changed.
+    // The entry stays valid after it is evicted.
+    std::shared_ptr<const Entry> find(std::string_view key);
+
+    // Replaces the entry of the key, evicting others until it fits. Returns
+    // false when the entry is larger than max_entry_length.
+    bool insert(std::string_view key, std::shared_ptr<const Entry> entry);
+
+    void clear();
+
+    size_t getMaxEntryLength() const { return options_.max_entry_length; };
+
+   private:
+    struct KeyHash {
+        typedef void is_transparent;
+
+        size_t operator()(std::string_view key) const {
+            return std::hash<std::string_view>()(key);
+        };
+    };
+
+    struct Node {
+        std::shared_ptr<const Entry> entry;
+        const std::string* key = nullptr;
+        size_t length = 0;
+        // Position in the clock ring.
+        size_t index = 0;
+        // Set by hits, cleared when the hand passes.
+        std::atomic<bool> is_referenced = false;
+        std::atomic<Clock::rep> valid_until = 0;
+    };
+
+    // Evicts entries until length more bytes fit.
+    void evict(size_t length);
+
+    void remove(Node* node);
+
+    StaticCacheOptions options_;
+
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, Node, KeyHash, std::equal_to<>> nodes_;
+    std::vector<Node*> ring_;
+    size_t hand_ = 0;
+    size_t length_ = 0;
+};
+
+}  // namespace simple_http
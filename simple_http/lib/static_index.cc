@@ -0,0 +1,201 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "static_index.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "content_coding.h"
+#include "file.h"
+#include "utils.h"
+
+namespace simple_http {
+
+static bool IsWithin(const std::filesystem::path& path,
+                     const std::filesystem::path& root) {
+    auto [root_end, path_end] =
+        std::mismatch(root.begin(), root.end(), path.begin(), path.end());
+    return root_end == root.end();
+}
+
+StaticIndex::StaticIndex(const std::filesystem::path& root,
+                         const StaticIndexOptions& options)
+    : options_(options) {
+    std::error_code error;
+    root_ = std::filesystem::canonical(root, error);
+    if (error) {
+        root_ = root;
+    }
+
+    tree_ = buildTree();
+    next_check_.store(
+        (Clock::now() + options_.check_interval).time_since_epoch().count(),
+        std::memory_order_relaxed);
+}
+
+std::optional<StaticIndex::Match> StaticIndex::find(
+    std::string_view request_path, ContentCodings accepted_codings) {
+    if (options_.check_interval.count() > 0) {
+        checkTree(Clock::now());
+    }
+
+    std::optional<std::string> key = NormalizeRequestPath(request_path);
+    if (!key) {
+        return std::nullopt;
+    }
+
+    std::shared_ptr<const Tree> tree = getTree();
+    auto iterator = tree->files.find(*key);
+    if (iterator == tree->files.end()) {
+        return std::nullopt;
+    }
+
+    const Node& node = iterator->second;
+    ContentCoding coding = ContentCoding::kIdentity;
+    for (size_t i = 1; i < kContentCodingsCount; i++) {
+        auto variant = static_cast<ContentCoding>(i);
+        if ((node.codings & accepted_codings & ToContentCodings(variant)) &&
+            node.sizes[i] < node.sizes[static_cast<size_t>(coding)]) {
+            coding = variant;
+        }
+    }
+
+    Match match;
+    match.path = node.path;
+    match.path += GetContentCodingExtension(coding);
+    match.key = node.key;
+    match.key += GetContentCodingExtension(coding);
+    match.coding = coding;
+    match.is_negotiated = node.codings != ToContentCodings(coding);
+    return match;
+}
+
+void StaticIndex::rebuild() {
+    std::shared_ptr<const Tree> tree = buildTree();
+    std::unique_lock lock(mutex_);
+    tree_ = std::move(tree);
+}
+
+std::shared_ptr<const StaticIndex::Tree> StaticIndex::buildTree() const {
+    auto tree = std::make_shared<Tree>();
+    File::OpenError open_error;
+    tree->directories.emplace_back(root_,
+                                   File::readStatus(root_, open_error));
+
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator iterator(
+        root_, std::filesystem::directory_options::skip_permission_denied,
+        error);
+    for (; !error && iterator != std::filesystem::end(iterator);
+         iterator.increment(error)) {
+        const std::filesystem::directory_entry& entry = *iterator;
+        const std::filesystem::path& path = entry.path();
+        std::error_code entry_error;
+        if (entry.is_directory(entry_error)) {
+            // The iterator does not follow directory symlinks.
+            if (!entry.is_symlink(entry_error)) {
+                tree->directories.emplace_back(
+                    path, File::readStatus(path, open_error));
+            }
+
+            continue;
+        }
+
+        if (!entry.is_regular_file(entry_error) ||
+            path.filename().generic_u8string().starts_with(u8"_")) {
+            continue;
+        }
+
+        if (entry.is_symlink(entry_error) &&
+            !IsWithin(std::filesystem::canonical(path, entry_error), root_)) {
+            continue;
+        }
+
+        std::u8string relative_path =
+            path.lexically_relative(root_).generic_u8string();
+        Node node;
+        node.path = path;
+        node.key = "/";
+        node.key.append(relative_path.begin(), relative_path.end());
+        node.codings = ToContentCodings(ContentCoding::kIdentity);
+        node.sizes[0] = entry.file_size(entry_error);
+        std::string key = node.key;
+        tree->files.emplace(std::move(key), std::move(node));
+    }
+
+    // Compressed siblings, e.g. app.js.br, become variants of their files.
+    for (auto& [key, node] : tree->files) {
+        for (size_t i = 1; i < kContentCodingsCount; i++) {
+            std::string_view extension =
+                GetContentCodingExtension(static_cast<ContentCoding>(i));
+            if (!key.ends_with(extension)) {
+                continue;
+            }
+
+            auto original = tree->files.find(
+                key.substr(0, key.length() - extension.length()));
+            if (original != tree->files.end()) {
+                original->second.codings |=
+                    ToContentCodings(static_cast<ContentCoding>(i));
+                original->second.sizes[i] = node.sizes[0];
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, Node>> directory_nodes;
+    for (const auto& [key, node] : tree->files) {
+        if (node.path.filename() == "index.html") {
+            std::string directory_key = key.substr(0, key.rfind('/'));
+            directory_nodes.emplace_back(
+                directory_key.empty() ? "/" : directory_key, node);
+        }
+    }
+
+    for (auto& [key, node] : directory_nodes) {
+        tree->files.emplace(std::move(key), std::move(node));
+    }
+
+    return tree;
+}
+
+std::shared_ptr<const StaticIndex::Tree> StaticIndex::getTree() {
+    std::shared_lock lock(mutex_);
+    return tree_;
+}
+
+void StaticIndex::checkTree(Clock::time_point now) {
+    Clock::rep next_check = next_check_.load(std::memory_order_relaxed);
+    if (now.time_since_epoch().count() < next_check) {
+        return;
+    }
+
+    // One lookup checks the directories, the others go on meanwhile.
+    Clock::rep following_check =
+        (now + options_.check_interval).time_since_epoch().count();
+    if (!next_check_.compare_exchange_strong(next_check, following_check,
+                                             std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::shared_ptr<const Tree> tree = getTree();
+    for (const auto& [path, status] : tree->directories) {
+        File::OpenError error;
+        if (File::readStatus(path, error) != status) {
+            rebuild();
+            return;
+        }
+    }
+}
+
+}  // namespace simple_http
@@ -0,0 +1,106 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "content_coding.h"
+#include "file.h"
+
+namespace simple_http {
+
+struct StaticIndexOptions {
+    // How often lookups check whether the directories changed, zero turns
+    // the checks off.
+    std::chrono::milliseconds check_interval = std::chrono::milliseconds(1000);
+};
+
+// The files of a static directory by their request paths, listed once so
+// that resolving a request touches no file system metadata. A directory is
+// served as its index.html, files starting with '_' are hidden, symlinks
+// leading out of the root are skipped and directory symlinks are not
+// followed. Files with compressed siblings, e.g. app.js.br or app.js.gz,
+// are served as the smallest variant the client accepts. Once per check
+// interval one lookup compares the statuses of the listed directories with
+// the disk and lists the tree again if any changed, e.g. after a file was
+// added or removed. Thread-safe.
+class StaticIndex {
+   public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit StaticIndex(const std::filesystem::path& root,
+                         const StaticIndexOptions& options = {});
+
+    StaticIndex(const StaticIndex&) = delete;
+    StaticIndex& operator=(const StaticIndex&) = delete;
+
+    // A file to serve for a request.
+    struct Match {
+        std::filesystem::path path;
+        // The request path of the file itself, different for every variant,
+        // e.g. "/index.html.br" for "/", so it suits as a cache key.
+        std::string key;
+        ContentCoding coding = ContentCoding::kIdentity;
+        // Whether the file has other variants, so the response depends on
+        // Accept-Encoding.
+        bool is_negotiated = false;
+    };
+
+    // Returns the file of the request path, see NormalizeRequestPath(), or
+    // std::nullopt when there is none. Of the variants in the accepted
+    // codings the smallest one is chosen.
+    std::optional<Match> find(
+        std::string_view request_path,
+        ContentCodings accepted_codings =
+            ToContentCodings(ContentCoding::kIdentity));
+
+    // Lists the directory tree again.
+    void rebuild();
+
+   private:
+    struct Node {
+        std::filesystem::path path;
+        std::string key;
+        // The identity coding and those of the compressed siblings.
+        ContentCodings codings = 0;
+        // Sizes of the variants by coding.
+        std::array<uint64_t, kContentCodingsCount> sizes{};
+    };
+
+    struct Tree {
+        // Normalized request paths to the files.
+        std::unordered_map<std::string, Node> files;
+        std::vector<std::pair<std::filesystem::path, File::Status>>
+            directories;
+    };
+
+    std::shared_ptr<const Tree> buildTree() const;
+
+    std::shared_ptr<const Tree> getTree();
+
+    // Rebuilds the tree when a directory changed since the last check.
+    void checkTree(Clock::time_point now);
+
+    std::filesystem::path root_;
+    StaticIndexOptions options_;
+
+    std::shared_mutex mutex_;
+    std::shared_ptr<const Tree> tree_;
+    std::atomic<Clock::rep> next_check_;
+};
+
+}  // namespace simple_http
@@ -0,0 +1,101 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace simple_http {
+
+template <typename Signature, size_t Length = 48>
+class TaskSlot;
+
+// A callable kept inside the slot, so that storing a task never allocates.
+// Callables larger than Length bytes are rejected at compile time.
+template <typename Result, typename... Args, size_t Length>
+class TaskSlot<Result(Args...), Length> {
+   public:
+    TaskSlot() = default;
+
+    template <typename Callable,
+              typename = std::enable_if_t<
+                  !std::is_same_v<std::decay_t<Callable>, TaskSlot>>>
+    TaskSlot(Callable&& callable) {
+        typedef std::decay_t<Callable> Stored;
+        static_assert(sizeof(Stored) <= Length,
+                      "The task does not fit into the slot");
+        static_assert(alignof(Stored) <= alignof(std::max_align_t));
+        static_assert(std::is_nothrow_move_constructible_v<Stored>);
+
+        new (storage_) Stored(std::forward<Callable>(callable));
+        invoke_ = [](void* storage, Args... args) -> Result {
+            return (*static_cast<Stored*>(storage))(
+                std::forward<Args>(args)...);
+        };
+        manage_ = [](void* storage, void* destination) {
+            Stored* stored = static_cast<Stored*>(storage);
+            if (destination != nullptr) {
+                new (destination) Stored(std::move(*stored));
+            }
+            stored->~Stored();
+        };
+    };
+
+    TaskSlot(const TaskSlot&) = delete;
+    TaskSlot& operator=(const TaskSlot&) = delete;
+
+    TaskSlot(TaskSlot&& other) noexcept { moveFrom(other); };
+
+    TaskSlot& operator=(TaskSlot&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+
+        return *this;
+    };
+
+    ~TaskSlot() { reset(); };
+
+    explicit operator bool() const { return invoke_ != nullptr; };
+
+    Result operator()(Args... args) {
+        return invoke_(storage_, std::forward<Args>(args)...);
+    };
+
+    void reset() {
+        if (manage_ != nullptr) {
+            manage_(storage_, nullptr);
+        }
+
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    };
+
+   private:
+    // Moves the callable to the destination unless it is null, then
+    // destroys it.
+    typedef void Manage(void* storage, void* destination);
+
+    void moveFrom(TaskSlot& other) {
+        if (other.manage_ == nullptr) {
+            return;
+        }
+
+        other.manage_(other.storage_, storage_);
+        invoke_ = other.invoke_;
+        manage_ = other.manage_;
+        other.invoke_ = nullptr;
+        other.manage_ = nullptr;
+    };
+
+    alignas(std::max_align_t) std::byte storage_[Length];
+    Result (*invoke_)(void* storage, Args... args) = nullptr;
+    Manage* manage_ = nullptr;
+};
+
+}  // namespace simple_http
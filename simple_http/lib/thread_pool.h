@@ -4,39 +4,101 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
-#include <condition_variable>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <queue>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "codel_queue.h"
+#include "mpmc_queue.h"
+#include "task_slot.h"
+
 namespace simple_http {
 
+// Tells the processor that the thread is spinning.
+inline void PauseSpinning() {
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// How the tasks are distributed between the workers.
+enum class ThreadPoolScheduling {
+    // One queue for all the workers, tasks are taken in the posted order.
+    kSharedQueue = 0,
+    // Every worker has its own queue. Tasks are posted to the least loaded
+    // worker (to its own queue when posted by a worker), and a worker with
+    // nothing to do takes tasks from the queues of others.
+    kWorkStealing = 1,
+};
+
+// The order in which a queue hands out its tasks.
+enum class ThreadPoolDiscipline {
+    // Lock-free, in the posted order.
+    kFifo = 0,
+    // Bounds the waiting time, see CoDelQueue. Expired tasks are still
+    // called, with is_expired set.
+    kCoDel = 1,
+};
+
+struct ThreadPoolOptions {
+    ThreadPoolScheduling scheduling = ThreadPoolScheduling::kSharedQueue;
+    ThreadPoolDiscipline discipline = ThreadPoolDiscipline::kFifo;
+    // For kCoDel.
+    CoDelOptions codel;
+};
+
 template <typename ThreadState>
 class ThreadPool {
    public:
-    typedef void Task(ThreadState* state);
+    // With is_expired the task waited too long or the pool is being
+    // destroyed, it should only release what it holds.
+    typedef void Task(ThreadState* state, bool is_expired);
+
+    typedef TaskSlot<Task> TaskType;
 
     typedef std::unique_ptr<ThreadState> ThreadStateFactory(size_t index);
 
     ~ThreadPool() {
-        {
-            std::unique_lock lock(mutex_);
-            stopped_ = true;
-        }
-        condition_.notify_all();
+        stopped_.store(true);
+        wake_epoch_.fetch_add(1);
+        wake_epoch_.notify_all();
         for (ThreadData& data : threads_data_) {
             data.thread.join();
         }
+
+        // Tasks left in the queues only release what they hold, e.g. close
+        // accepted sockets.
+        if (!threads_data_.empty()) {
+            TaskType task;
+            bool is_expired;
+            for (size_t i = 0; i < queues_count_; i++) {
+                while (queues_[i].tryPop(task, is_expired)) {
+                    try {
+                        task(threads_data_[0].state.get(), true);
+                    } catch (...) {
+                    }
+                    task.reset();
+                }
+            }
+        }
     }
 
     static std::unique_ptr<ThreadPool<ThreadState>> create(
         size_t threads_count,
-        const std::function<ThreadStateFactory>& create_state) {
+        const std::function<ThreadStateFactory>& create_state,
+        const ThreadPoolOptions& options = ThreadPoolOptions()) {
         assert(threads_count >= 0);
 
         if (threads_count == 0) {
@@ -44,24 +106,40 @@ class ThreadPool {
         }
 
         std::unique_ptr<ThreadPool<ThreadState>> pool(new ThreadPool());
-        if (pool->initialize(threads_count, create_state)) {
+        if (pool->initialize(threads_count, create_state, options)) {
             return pool;
         } else {
             return nullptr;
         }
     }
 
-    void post(std::function<Task>&& task) {
-        {
-            std::unique_lock lock(mutex_);
-            tasks_.push(std::move(task));
+    // The task is kept inside the queue, so posting does not allocate. When
+    // the queues are full the caller waits for a worker to take a task.
+    template <typename Callable>
+    void post(Callable&& task) {
+        TaskType slot(std::forward<Callable>(task));
+        size_t index = selectQueue();
+        while (!pushTask(index, slot)) {
+            std::this_thread::yield();
+        }
+
+        // Pairs with the increment of sleeping_count_ by a parking worker:
+        // either the worker sees the task or this sees the worker.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_count_.load(std::memory_order_relaxed) != 0) {
+            wake_epoch_.fetch_add(1, std::memory_order_release);
+            wake_epoch_.notify_one();
         }
-        condition_.notify_one();
     }
 
+    // Approximate, it does not synchronize with the workers.
     size_t getPlannedTasksCount() {
-        std::unique_lock lock(mutex_);
-        return tasks_.size();
+        size_t count = 0;
+        for (size_t i = 0; i < queues_count_; i++) {
+            count += queues_[i].getSize();
+        }
+
+        return count;
     }
 
    private:
@@ -70,11 +148,65 @@ class ThreadPool {
         std::unique_ptr<ThreadState> state;
     };
 
-    ThreadPool() = default;
+    static constexpr size_t kTasksCapacity = 1024;
+
+    struct alignas(64) TaskQueue {
+        bool tryPush(TaskType& task) {
+            return fifo_tasks ? fifo_tasks->tryPush(task)
+                              : codel_tasks->tryPush(task);
+        };
+
+        bool tryPop(TaskType& task, bool& is_expired) {
+            if (fifo_tasks) {
+                is_expired = false;
+                return fifo_tasks->tryPop(task);
+            }
+
+            return codel_tasks->tryPop(task, is_expired);
+        };
+
+        size_t getSize() const {
+            return fifo_tasks ? fifo_tasks->getSize()
+                              : codel_tasks->getSize();
+        };
+
+        // One of them, depending on the discipline.
+        std::unique_ptr<MpmcQueue<TaskType>> fifo_tasks;
+        std::unique_ptr<CoDelQueue<TaskType>> codel_tasks;
+        // Whether the owning worker runs a task, for the load estimate.
+        std::atomic<bool> is_busy = false;
+    };
+
+    // Attempts to take a task before the worker goes to sleep, a task
+    // posted soon after the previous one is taken without a wakeup.
+    static constexpr size_t kSpinsCount = 500;
+
+    // Spinning on a single processor only delays the producer.
+    ThreadPool()
+        : spins_count_(std::thread::hardware_concurrency() > 1 ? kSpinsCount
+                                                               : 0){};
 
     bool initialize(size_t threads_count,
-                    const std::function<ThreadStateFactory>& create_state) {
+                    const std::function<ThreadStateFactory>& create_state,
+                    const ThreadPoolOptions& options) {
         try {
+            queues_count_ =
+                options.scheduling == ThreadPoolScheduling::kWorkStealing
+                    ? threads_count
+                    : 1;
+            queues_.reset(new TaskQueue[queues_count_]);
+            for (size_t i = 0; i < queues_count_; i++) {
+                if (options.discipline == ThreadPoolDiscipline::kCoDel) {
+                    queues_[i].codel_tasks =
+                        std::make_unique<CoDelQueue<TaskType>>(kTasksCapacity,
+                                                               options.codel);
+                } else {
+                    queues_[i].fifo_tasks =
+                        std::make_unique<MpmcQueue<TaskType>>(kTasksCapacity);
+                }
+            }
+            threads_data_.reserve(threads_count);
+
             for (size_t i = 0; i < threads_count; i++) {
                 ThreadData data;
 
@@ -84,27 +216,19 @@ class ThreadPool {
                 }
 
                 std::thread thread([this, i] {
-                    while (true) {
-                        std::function<Task> task;
-
-                        {
-                            std::unique_lock lock(mutex_);
-                            condition_.wait(lock, [this] {
-                                return stopped_ || !tasks_.empty();
-                            });
-                            if (stopped_) {
-                                return;
-                            }
-
-                            task = std::move(tasks_.front());
-                            tasks_.pop();
-                        }
+                    current_pool_ = this;
+                    current_index_ = i % queues_count_;
 
+                    TaskType task;
+                    bool is_expired;
+                    while (waitTask(task, is_expired)) {
+                        setBusy(true);
                         try {
-                            task(threads_data_[i].state.get());
+                            task(threads_data_[i].state.get(), is_expired);
                         } catch (...) {
-                            continue;
                         }
+                        task.reset();
+                        setBusy(false);
                     }
                 });
                 data.thread = std::move(thread);
@@ -118,12 +242,112 @@ class ThreadPool {
         return true;
     }
 
+    // The queue of the calling worker, otherwise the one with the fewest
+    // tasks counting the running one. Ties go round-robin.
+    size_t selectQueue() {
+        if (queues_count_ == 1) {
+            return 0;
+        }
+
+        if (current_pool_ == this) {
+            return current_index_;
+        }
+
+        size_t start = next_queue_.fetch_add(1, std::memory_order_relaxed);
+        size_t best_index = 0;
+        size_t best_load = SIZE_MAX;
+        for (size_t i = 0; i < queues_count_ && best_load != 0; i++) {
+            size_t index = (start + i) % queues_count_;
+            const TaskQueue& queue = queues_[index];
+            size_t load = queue.getSize() +
+                          queue.is_busy.load(std::memory_order_relaxed);
+            if (load < best_load) {
+                best_index = index;
+                best_load = load;
+            }
+        }
+
+        return best_index;
+    }
+
+    // Falls back to the other queues when the selected one is full.
+    bool pushTask(size_t index, TaskType& task) {
+        for (size_t i = 0; i < queues_count_; i++) {
+            if (queues_[(index + i) % queues_count_].tryPush(task)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Takes a task from the own queue of the worker, then from the others.
+    bool popTask(TaskType& task, bool& is_expired) {
+        for (size_t i = 0; i < queues_count_; i++) {
+            if (queues_[(current_index_ + i) % queues_count_].tryPop(
+                    task, is_expired)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void setBusy(bool is_busy) {
+        if (queues_count_ > 1) {
+            queues_[current_index_].is_busy.store(is_busy,
+                                                  std::memory_order_relaxed);
+        }
+    }
+
+    // Spins for a while, then sleeps until a task is posted. Returns false
+    // when the pool is stopped.
+    bool waitTask(TaskType& task, bool& is_expired) {
+        while (true) {
+            if (stopped_.load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            for (size_t i = 0; i < spins_count_; i++) {
+                if (stopped_.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                if (popTask(task, is_expired)) {
+                    return true;
+                }
+
+                PauseSpinning();
+            }
+
+            uint32_t epoch = wake_epoch_.load(std::memory_order_acquire);
+            sleeping_count_.fetch_add(1, std::memory_order_seq_cst);
+            if (popTask(task, is_expired)) {
+                sleeping_count_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (!stopped_.load()) {
+                wake_epoch_.wait(epoch, std::memory_order_acquire);
+            }
+            sleeping_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // The worker running on the thread, if any.
+    static inline thread_local ThreadPool* current_pool_ = nullptr;
+    static inline thread_local size_t current_index_ = 0;
+
     std::vector<ThreadData> threads_data_;
 
-    std::mutex mutex_;
-    std::condition_variable condition_;
-    std::queue<std::function<Task>> tasks_;
-    bool stopped_ = false;
+    std::unique_ptr<TaskQueue[]> queues_;
+    size_t queues_count_ = 0;
+    std::atomic<size_t> next_queue_ = 0;
+    size_t spins_count_;
+    // Incremented to wake sleeping workers, they wait for it to change.
+    std::atomic<uint32_t> wake_epoch_ = 0;
+    std::atomic<size_t> sleeping_count_ = 0;
+    std::atomic<bool> stopped_ = false;
 };
 
 }  // namespace simple_http
@@ -0,0 +1,233 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+
+namespace simple_http {
+
+// The farthest tick a timer is placed at, later ones are placed again when
+// it comes.
+static constexpr uint64_t kMaxDistance = (uint64_t{1} << (6 * 4)) - 1;
+
+void TimerWheel::Timer::cancel() {
+    if (wheel_ != nullptr) {
+        wheel_->cancel(this);
+    }
+}
+
+TimerWheel::TimerWheel(Clock::time_point now, std::chrono::milliseconds tick)
+    : origin_(now), tick_(tick) {
+    assert(tick.count() > 0);
+}
+
+TimerWheel::~TimerWheel() {
+    for (size_t level = 0; level < kLevelsCount; level++) {
+        for (size_t slot = 0; slot < kSlotsCount; slot++) {
+            for (Timer* timer = slots_[level][slot]; timer != nullptr;
+                 timer = timer->next_) {
+                timer->wheel_ = nullptr;
+            }
+        }
+    }
+
+    for (Timer* timer = expired_; timer != nullptr; timer = timer->next_) {
+        timer->wheel_ = nullptr;
+    }
+}
+
+void TimerWheel::schedule(Timer* timer, Clock::time_point deadline) {
+    if (timer->wheel_ != nullptr) {
+        timer->wheel_->cancel(timer);
+    }
+
+    timer->wheel_ = this;
+    timer->tick_ = getTick(deadline);
+    insert(timer);
+}
+
+void TimerWheel::cancel(Timer* timer) {
+    assert(timer->wheel_ == this);
+
+    unlink(timer);
+    timer->wheel_ = nullptr;
+}
+
+void TimerWheel::advance(Clock::time_point now) {
+    uint64_t target_tick =
+        now > origin_ ? static_cast<uint64_t>((now - origin_) / tick_) : 0;
+
+    while (current_tick_ < target_tick) {
+        if (count_ == 0) {
+            current_tick_ = target_tick;
+            break;
+        }
+
+        // Nothing happens before the end of the level 0 round.
+        if (occupied_[0] == 0) {
+            current_tick_ =
+                std::min(target_tick - 1, current_tick_ | (kSlotsCount - 1));
+        }
+
+        current_tick_++;
+        for (size_t level = kLevelsCount - 1; level > 0; level--) {
+            uint64_t mask = (uint64_t{1} << (kSlotBits * level)) - 1;
+            if ((current_tick_ & mask) == 0) {
+                cascade(level,
+                        (current_tick_ >> (kSlotBits * level)) &
+                            (kSlotsCount - 1));
+            }
+        }
+
+        cascade(0, current_tick_ & (kSlotsCount - 1));
+    }
+}
+
+TimerWheel::Timer* TimerWheel::takeExpired() {
+    Timer* timer = expired_;
+    if (timer != nullptr) {
+        cancel(timer);
+    }
+
+    return timer;
+}
+
+TimerWheel::Clock::time_point TimerWheel::getNextDeadline() const {
+    if (expired_ != nullptr) {
+        return origin_ + current_tick_ * tick_;
+    }
+
+    if (count_ == 0) {
+        return Clock::time_point::max();
+    }
+
+    // Occupied slots of a level always come after its current slot, except
+    // for the first top level slot in the last slot of a round, see
+    // insert().
+    uint64_t next_tick = UINT64_MAX;
+    for (size_t level = 0; level < kLevelsCount; level++) {
+        size_t shift = kSlotBits * level;
+        size_t current_slot = (current_tick_ >> shift) & (kSlotsCount - 1);
+        uint64_t later_slots =
+            current_slot == kSlotsCount - 1
+                ? 0
+                : occupied_[level] & (~uint64_t{0} << (current_slot + 1));
+        uint64_t round_start = (current_tick_ >> (shift + kSlotBits))
+                               << (shift + kSlotBits);
+        if (later_slots == 0 && level == kLevelsCount - 1 &&
+            (occupied_[level] & 1) != 0) {
+            next_tick = std::min(
+                next_tick, round_start + (uint64_t{1} << (shift + kSlotBits)));
+            continue;
+        }
+
+        if (later_slots == 0) {
+            continue;
+        }
+
+        uint64_t slot = static_cast<uint64_t>(std::countr_zero(later_slots));
+        next_tick = std::min(next_tick, round_start | (slot << shift));
+    }
+
+    return origin_ + next_tick * tick_;
+}
+
+uint64_t TimerWheel::getTick(Clock::time_point time) const {
+    if (time <= origin_) {
+        return 0;
+    }
+
+    // Rounded up, so that the timer does not expire before the time.
+    Clock::duration elapsed = time - origin_;
+    return static_cast<uint64_t>((elapsed + tick_ - Clock::duration(1)) /
+                                 tick_);
+}
+
+void TimerWheel::insert(Timer* timer) {
+    if (timer->tick_ <= current_tick_) {
+        link(timer, kExpiredLevel, 0);
+        return;
+    }
+
+    uint64_t tick = std::min(timer->tick_, current_tick_ + kMaxDistance);
+    // The level is given by the highest group of slot bits differing from
+    // the current tick, so the slot is reached by cascading in time.
+    uint64_t difference = tick ^ current_tick_;
+    size_t level = (std::bit_width(difference) - 1) / kSlotBits;
+    if (level >= kLevelsCount) {
+        // The tick is in a later round of the top level. The timer waits in
+        // the next top level slot, which comes before the tick, and is
+        // placed again then. In the last slot of a round that is the first
+        // slot, cascaded when the next round starts.
+        level = kLevelsCount - 1;
+        size_t current_slot =
+            (current_tick_ >> (kSlotBits * level)) & (kSlotsCount - 1);
+        size_t slot = (current_slot + 1) & (kSlotsCount - 1);
+        link(timer, static_cast<uint8_t>(level), static_cast<uint8_t>(slot));
+        return;
+    }
+
+    size_t slot = (tick >> (kSlotBits * level)) & (kSlotsCount - 1);
+    link(timer, static_cast<uint8_t>(level), static_cast<uint8_t>(slot));
+}
+
+void TimerWheel::link(Timer* timer, uint8_t level, uint8_t slot) {
+    Timer** head = level == kExpiredLevel ? &expired_ : &slots_[level][slot];
+    timer->level_ = level;
+    timer->slot_ = slot;
+    timer->previous_ = nullptr;
+    timer->next_ = *head;
+    if (*head != nullptr) {
+        (*head)->previous_ = timer;
+    }
+    *head = timer;
+
+    if (level != kExpiredLevel) {
+        occupied_[level] |= uint64_t{1} << slot;
+        count_++;
+    }
+}
+
+void TimerWheel::unlink(Timer* timer) {
+    Timer** head = timer->level_ == kExpiredLevel
+                       ? &expired_
+                       : &slots_[timer->level_][timer->slot_];
+    if (timer->previous_ != nullptr) {
+        timer->previous_->next_ = timer->next_;
+    } else {
+        *head = timer->next_;
+    }
+    if (timer->next_ != nullptr) {
+        timer->next_->previous_ = timer->previous_;
+    }
+    timer->previous_ = nullptr;
+    timer->next_ = nullptr;
+
+    if (timer->level_ != kExpiredLevel) {
+        if (*head == nullptr) {
+            occupied_[timer->level_] &= ~(uint64_t{1} << timer->slot_);
+        }
+        count_--;
+    }
+}
+
+void TimerWheel::cascade(size_t level, size_t slot) {
+    Timer* timer = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    occupied_[level] &= ~(uint64_t{1} << slot);
+
+    while (timer != nullptr) {
+        Timer* next = timer->next_;
+        count_--;
+        insert(timer);
+        timer = next;
+    }
+}
+
+}  // namespace simple_http
@@ -0,0 +1,104 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace simple_http {
+
+// Hierarchical timing wheel. Timers sit in four levels of 64 slots, a slot
+// of level 0 lasts one tick and a slot of every next level 64 times longer.
+// Scheduling and cancelling a timer take constant time, timers of a higher
+// level slot move down when the lower level wraps around. Deadlines are
+// rounded up to whole ticks and timers never expire early. Not thread-safe.
+class TimerWheel {
+   public:
+    typedef std::chrono::steady_clock Clock;
+
+    class Timer {
+       public:
+        Timer() = default;
+        explicit Timer(void* data) : data_(data){};
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        ~Timer() { cancel(); };
+
+        void cancel();
+
+        // Scheduled or expired but not taken yet.
+        bool isScheduled() const { return wheel_ != nullptr; };
+
+        void* getData() const { return data_; };
+
+       private:
+        friend class TimerWheel;
+
+        void* data_ = nullptr;
+        TimerWheel* wheel_ = nullptr;
+        Timer* previous_ = nullptr;
+        Timer* next_ = nullptr;
+        uint64_t tick_ = 0;
+        uint8_t level_ = 0;
+        uint8_t slot_ = 0;
+    };
+
+    explicit TimerWheel(
+        Clock::time_point now = Clock::now(),
+        std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    ~TimerWheel();
+
+    // Reschedules the timer if it is already scheduled.
+    void schedule(Timer* timer, Clock::time_point deadline);
+
+    void cancel(Timer* timer);
+
+    // Moves the timers whose deadline has come by now to the expired ones.
+    void advance(Clock::time_point now);
+
+    // Returns an expired timer, which is no longer scheduled, or nullptr.
+    Timer* takeExpired();
+
+    // The earliest time advance() may expire a timer, max() without timers.
+    Clock::time_point getNextDeadline() const;
+
+   private:
+    static constexpr size_t kLevelsCount = 4;
+    static constexpr size_t kSlotBits = 6;
+    static constexpr size_t kSlotsCount = 1 << kSlotBits;
+    static constexpr uint8_t kExpiredLevel = kLevelsCount;
+
+    uint64_t getTick(Clock::time_point time) const;
+
+    // Puts the timer into the slot of its tick, or to the expired ones.
+    void insert(Timer* timer);
+
+    void link(Timer* timer, uint8_t level, uint8_t slot);
+
+    void unlink(Timer* timer);
+
+    // Takes all the timers of the slot and inserts them again.
+    void cascade(size_t level, size_t slot);
+
+    Clock::time_point origin_;
+    Clock::duration tick_;
+    uint64_t current_tick_ = 0;
+
+    Timer* slots_[kLevelsCount][kSlotsCount] = {};
+    // Bit i is set when slot i of the level has timers.
+    uint64_t occupied_[kLevelsCount] = {};
+    Timer* expired_ = nullptr;
+    // Timers in the slots.
+    size_t count_ = 0;
+};
+
+}  // namespace simple_http
@@ -4,27 +4,61 @@
 
 #include "utils.h"
 
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 
+#include "char_classes.h"
+#include "content_coding.h"
+#include "file.h"
 #include "http_headers.h"
+#include "open_file_cache.h"
 #include "outgoing_message.h"
+#include "static_cache.h"
+#include "static_index.h"
 
 namespace simple_http {
 
+static void SendFile(OutgoingMessage& response, const std::string& code,
+                     const std::string& message,
+                     const StaticIndex::Match& match, File& file);
+
+static void SendOpenFile(OutgoingMessage& response,
+                         const OpenFileCache::Entry& entry);
+
+// The identity variant of a file not found by a StaticIndex.
+static StaticIndex::Match MatchFile(const std::filesystem::path& file_path,
+                                    std::string_view key);
+
+// Caches the response under the key of the match.
+static void ResponseWithCachedFile(OutgoingMessage& response,
+                                   const std::string& code,
+                                   const std::string& message,
+                                   const StaticIndex::Match& match,
+                                   StaticCache& cache,
+                                   OpenFileCache* open_files);
+
+// Returns nullptr when the file cannot be read.
+static std::shared_ptr<StaticCache::Entry> ReadFileResponse(
+    const std::string& code, const std::string& message,
+    const StaticIndex::Match& match, File& file);
+
+// The same headers as SendFile() writes, serialized for writeSerialized().
+static std::string MakeFileHead(const std::string& code,
+                                const std::string& message,
+                                const StaticIndex::Match& match,
+                                uint64_t length);
+
+// The type of the original file for a compressed variant.
+static std::string GetFileContentType(const StaticIndex::Match& match);
+
 void PrintHeaders(const HttpHeaders& headers) {
-    for (auto headers_it = headers.begin(); headers_it != headers.end();
-         headers_it++) {
-        std::cout << headers_it->first << ": [" << std::endl;
-        auto header_values = headers_it->second;
-        for (auto header_it = header_values.begin();
-             header_it != header_values.end(); header_it++) {
-            std::cout << "  \"" << *header_it << "\"" << std::endl;
-        }
-        std::cout << "]" << std::endl;
+    for (const HttpHeaders::Header& header : headers) {
+        std::cout << header.name << ": \"" << header.value << "\"" << std::endl;
     }
 }
 
@@ -73,9 +107,8 @@ std::string GetMimeType(const std::wstring& extension) {
 }
 
 std::optional<std::filesystem::path> GetRequestFilePath(
-    const std::string& request_path, const std::filesystem::path& base) {
-    std::string_view relative_path(request_path.c_str() + 1,
-                                   request_path.length() - 1);
+    std::string_view request_path, const std::filesystem::path& base) {
+    std::string_view relative_path = request_path.substr(1);
     std::filesystem::path file_path =
         std::filesystem::weakly_canonical(base / relative_path);
     if (!file_path.native().starts_with(base.native()) ||
@@ -97,50 +130,312 @@ std::optional<std::filesystem::path> GetRequestFilePath(
     return file_path;
 }
 
+std::optional<std::string> NormalizeRequestPath(
+    std::string_view request_path) {
+    if (request_path.empty() || request_path[0] != '/') {
+        return std::nullopt;
+    }
+
+    std::string normalized;
+    normalized.reserve(request_path.length());
+    size_t index = 0;
+    while (index < request_path.length()) {
+        if (request_path[index] == '/') {
+            index++;
+            continue;
+        }
+
+        // The segment is decoded right into its place.
+        size_t segment_start = normalized.length();
+        normalized += '/';
+        while (index < request_path.length() && request_path[index] != '/') {
+            char symbol = request_path[index];
+            if (symbol == '%') {
+                if (request_path.length() - index < 3 ||
+                    !IsCharClass(request_path[index + 1], kHex) ||
+                    !IsCharClass(request_path[index + 2], kHex)) {
+                    return std::nullopt;
+                }
+
+                symbol = static_cast<char>(
+                    GetHexValue(request_path[index + 1]) * 16 +
+                    GetHexValue(request_path[index + 2]));
+                index += 2;
+            }
+
+            if (symbol == '/' || symbol == '\\' || symbol == '\0') {
+                return std::nullopt;
+            }
+
+            normalized += symbol;
+            index++;
+        }
+
+        std::string_view segment(normalized.data() + segment_start + 1,
+                                 normalized.length() - segment_start - 1);
+        if (segment == ".") {
+            normalized.resize(segment_start);
+        } else if (segment == "..") {
+            normalized.resize(segment_start);
+            if (normalized.empty()) {
+                return std::nullopt;
+            }
+
+            normalized.resize(normalized.rfind('/'));
+        }
+    }
+
+    if (normalized.empty()) {
+        normalized = "/";
+    }
+
+    return normalized;
+}
+
 void ResponseWithFile(OutgoingMessage& response, const std::string& code,
                       const std::string& message,
                       const std::filesystem::path& file_path) {
-    std::ifstream file(file_path, std::ios::binary);
-    if (!file.is_open()) {
+    File::OpenError open_error;
+    std::unique_ptr<File> file = File::open(file_path, open_error);
+    if (open_error != File::OpenError::kOk) {
+        std::cout << "File opening error" << std::endl;
+        return;
+    }
+
+    SendFile(response, code, message, MatchFile(file_path, {}), *file);
+}
+
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const std::filesystem::path& file_path,
+                      StaticCache& cache, std::string_view key) {
+    ResponseWithCachedFile(response, code, message,
+                           MatchFile(file_path, key), cache, nullptr);
+}
+
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const std::filesystem::path& file_path,
+                      StaticCache& cache, OpenFileCache& open_files,
+                      std::string_view key) {
+    ResponseWithCachedFile(response, code, message,
+                           MatchFile(file_path, key), cache, &open_files);
+}
+
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const StaticIndex::Match& match, StaticCache& cache,
+                      OpenFileCache& open_files) {
+    ResponseWithCachedFile(response, code, message, match, cache,
+                           &open_files);
+}
+
+std::shared_ptr<const StaticCache::Entry> RenderFileResponse(
+    const std::string& code, const std::string& message,
+    const std::filesystem::path& file_path) {
+    File::OpenError open_error;
+    std::unique_ptr<File> file = File::open(file_path, open_error);
+    if (open_error != File::OpenError::kOk) {
+        return nullptr;
+    }
+
+    return ReadFileResponse(code, message, MatchFile(file_path, {}), *file);
+}
+
+void ResponseWithRendered(OutgoingMessage& response,
+                          const StaticCache::Entry& entry) {
+    simple_http::OutgoingMessage::WriteError write_error;
+    write_error = response.writeSerialized(entry.head, entry.body);
+    if (write_error != simple_http::OutgoingMessage::WriteError::kOk) {
+        std::cout << "Send error: " << static_cast<int>(write_error)
+                  << std::endl;
+        return;
+    }
+
+    response.end();
+}
+
+bool ResponseFromCache(OutgoingMessage& response, StaticCache& cache,
+                       std::string_view key) {
+    std::shared_ptr<const StaticCache::Entry> entry = cache.find(key);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    ResponseWithRendered(response, *entry);
+    return true;
+}
+
+bool ResponseFromCache(OutgoingMessage& response, OpenFileCache& cache,
+                       std::string_view key) {
+    std::shared_ptr<const OpenFileCache::Entry> entry = cache.find(key);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    SendOpenFile(response, *entry);
+    return true;
+}
+
+static StaticIndex::Match MatchFile(const std::filesystem::path& file_path,
+                                    std::string_view key) {
+    StaticIndex::Match match;
+    match.path = file_path;
+    match.key = key;
+    match.coding = ContentCoding::kIdentity;
+    match.is_negotiated = false;
+    return match;
+}
+
+static void ResponseWithCachedFile(OutgoingMessage& response,
+                                   const std::string& code,
+                                   const std::string& message,
+                                   const StaticIndex::Match& match,
+                                   StaticCache& cache,
+                                   OpenFileCache* open_files) {
+    File::OpenError open_error;
+    std::unique_ptr<File> file = File::open(match.path, open_error);
+    if (open_error != File::OpenError::kOk) {
         std::cout << "File opening error" << std::endl;
         return;
     }
 
-    file.seekg(0, std::ios::end);
-    std::streampos end_postion = file.tellg();
-    size_t file_size = static_cast<size_t>(end_postion);
-    file.seekg(0, std::ios::beg);
+    if (file->getSize() > cache.getMaxEntryLength() && open_files != nullptr) {
+        auto entry = std::make_shared<OpenFileCache::Entry>();
+        entry->path = match.path;
+        entry->head = MakeFileHead(code, message, match, file->getSize());
+        entry->file = std::move(file);
+        open_files->insert(match.key, entry);
+        return SendOpenFile(response, *entry);
+    }
+
+    if (file->getSize() > cache.getMaxEntryLength()) {
+        return SendFile(response, code, message, match, *file);
+    }
+
+    std::shared_ptr<StaticCache::Entry> entry =
+        ReadFileResponse(code, message, match, *file);
+    if (entry == nullptr) {
+        std::cout << "File reading error" << std::endl;
+        return;
+    }
+
+    cache.insert(match.key, entry);
+    ResponseWithRendered(response, *entry);
+}
+
+static std::shared_ptr<StaticCache::Entry> ReadFileResponse(
+    const std::string& code, const std::string& message,
+    const StaticIndex::Match& match, File& file) {
+    auto entry = std::make_shared<StaticCache::Entry>();
+    entry->body.resize(static_cast<size_t>(file.getSize()));
+    size_t offset = 0;
+    while (offset < entry->body.length()) {
+        File::ReadError read_error;
+        size_t bytes_count =
+            file.read(entry->body.data() + offset,
+                      entry->body.length() - offset, offset, read_error);
+        if (read_error != File::ReadError::kOk || bytes_count == 0) {
+            return nullptr;
+        }
+
+        offset += bytes_count;
+    }
+
+    entry->head = MakeFileHead(code, message, match, offset);
+    entry->path = match.path;
+    entry->status = file.getStatus();
+    return entry;
+}
+
+static std::string MakeFileHead(const std::string& code,
+                                const std::string& message,
+                                const StaticIndex::Match& match,
+                                uint64_t length) {
+    std::string head = ' ' + code + ' ' + message + "\r\n";
+    head += "Content-Length: " + std::to_string(length) + "\r\n";
+    head += "Content-Type: " + GetFileContentType(match) + "\r\n";
+    if (match.coding != ContentCoding::kIdentity) {
+        head += "Content-Encoding: ";
+        head += GetContentCodingName(match.coding);
+        head += "\r\n";
+    }
+
+    if (match.is_negotiated) {
+        head += "Vary: Accept-Encoding\r\n";
+    }
+
+    head += "X-Powered-By: simple_http\r\n";
+    return head;
+}
+
+static std::string GetFileContentType(const StaticIndex::Match& match) {
+    std::filesystem::path original_path = match.path;
+    if (match.coding != ContentCoding::kIdentity) {
+        original_path.replace_extension();
+    }
+
+    return GetMimeType(original_path.extension().generic_wstring()) +
+           "; charset=UTF-8";
+}
+
+static void SendFile(OutgoingMessage& response, const std::string& code,
+                     const std::string& message,
+                     const StaticIndex::Match& match, File& file) {
+    size_t file_size = static_cast<size_t>(file.getSize());
 
     simple_http::HttpHeaders& headers = response.getHeaders();
-    headers.add("Content-Length", std::to_string(file_size));
-    headers.add("Content-Type",
-                GetMimeType(file_path.extension().generic_wstring()) +
-                    "; charset=UTF-8");
+    headers.add(HttpHeaderId::kContentLength, std::to_string(file_size));
+    headers.add(HttpHeaderId::kContentType, GetFileContentType(match));
+    if (match.coding != ContentCoding::kIdentity) {
+        headers.add(HttpHeaderId::kContentEncoding,
+                    GetContentCodingName(match.coding));
+    }
+
+    if (match.is_negotiated) {
+        headers.add(HttpHeaderId::kVary, "Accept-Encoding");
+    }
+
     headers.add("X-Powered-By", "simple_http");
 
     response.writeHead(code, message);
 
-    char read_buffer[4096];
-    while (file.good()) {
-        file.read(read_buffer, sizeof(read_buffer));
-        size_t bytes_readed = file.gcount();
-        if (bytes_readed > 0) {
-            simple_http::OutgoingMessage::WriteError write_error;
-            write_error = response.write(read_buffer, bytes_readed);
-            if (write_error != simple_http::OutgoingMessage::WriteError::kOk) {
-                std::cout << "Send error: " << static_cast<int>(write_error)
-                          << std::endl;
-                return;
-            }
-        }
+    simple_http::OutgoingMessage::WriteError write_error;
+    write_error = response.sendFile(file.getDescriptor(), 0, file_size);
+    if (write_error == simple_http::OutgoingMessage::WriteError::kFileError) {
+        std::cout << "File reading error" << std::endl;
+        return;
+    }
+
+    if (write_error != simple_http::OutgoingMessage::WriteError::kOk) {
+        std::cout << "Send error: " << static_cast<int>(write_error)
+                  << std::endl;
+        return;
+    }
+
+    response.end();
+}
+
+static void SendOpenFile(OutgoingMessage& response,
+                         const OpenFileCache::Entry& entry) {
+    simple_http::OutgoingMessage::WriteError write_error;
+    write_error = response.writeSerialized(entry.head, std::string_view());
+    if (write_error == simple_http::OutgoingMessage::WriteError::kOk) {
+        write_error = response.sendFile(entry.file->getDescriptor(), 0,
+                                        entry.file->getSize());
     }
 
-    if (file.bad() || !file.eof()) {
+    if (write_error == simple_http::OutgoingMessage::WriteError::kFileError) {
         std::cout << "File reading error" << std::endl;
         return;
     }
 
-    file.close();
+    if (write_error != simple_http::OutgoingMessage::WriteError::kOk) {
+        std::cout << "Send error: " << static_cast<int>(write_error)
+                  << std::endl;
+        return;
+    }
+
     response.end();
 }
 
@@ -6,11 +6,16 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "http_headers.h"
+#include "open_file_cache.h"
 #include "outgoing_message.h"
+#include "static_cache.h"
+#include "static_index.h"
 
 namespace simple_http {
 
@@ -19,10 +24,61 @@ void PrintHeaders(const HttpHeaders& headers);
 std::string GetMimeType(const std::wstring& extension);
 
 std::optional<std::filesystem::path> GetRequestFilePath(
-    const std::string& request_path, const std::filesystem::path& base);
+    std::string_view request_path, const std::filesystem::path& base);
+
+// Decodes percent-encoded bytes, drops "." segments, resolves ".." ones
+// and merges repeated slashes without touching the file system. The result
+// starts with a slash and ends with one only for the root. Returns
+// std::nullopt when the path escapes the root or a segment decodes to
+// '/', '\\' or a zero byte.
+std::optional<std::string> NormalizeRequestPath(std::string_view request_path);
 
 void ResponseWithFile(OutgoingMessage& response, const std::string& code,
                       const std::string& message,
                       const std::filesystem::path& file_path);
 
+// Like the above, but keeps the whole response in the cache under the key,
+// so that ResponseFromCache() serves it without touching the file system.
+// Files too large for the cache are sent from the disk every time.
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const std::filesystem::path& file_path,
+                      StaticCache& cache, std::string_view key);
+
+// Also keeps files too large for the static cache open in open_files.
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const std::filesystem::path& file_path,
+                      StaticCache& cache, OpenFileCache& open_files,
+                      std::string_view key);
+
+// Serves a file found by a StaticIndex, with Content-Encoding for a
+// compressed variant and Vary when the file has other variants, and caches
+// the response under the key of the match.
+void ResponseWithFile(OutgoingMessage& response, const std::string& code,
+                      const std::string& message,
+                      const StaticIndex::Match& match, StaticCache& cache,
+                      OpenFileCache& open_files);
+
+// Reads the whole file into a response serialized beforehand, with the
+// same headers as ResponseWithFile(). Returns nullptr when the file cannot
+// be read.
+std::shared_ptr<const StaticCache::Entry> RenderFileResponse(
+    const std::string& code, const std::string& message,
+    const std::filesystem::path& file_path);
+
+// Sends a response made by RenderFileResponse().
+void ResponseWithRendered(OutgoingMessage& response,
+                          const StaticCache::Entry& entry);
+
+// Responds with the response cached under the key. Returns false when it
+// is not cached and nothing is sent.
+bool ResponseFromCache(OutgoingMessage& response, StaticCache& cache,
+                       std::string_view key);
+
+// Sends the file kept open under the key with its cached head. Returns
+// false when it is not cached or has changed, and nothing is sent.
+bool ResponseFromCache(OutgoingMessage& response, OpenFileCache& cache,
+                       std::string_view key);
+
 }  // namespace simple_http
@@ -0,0 +1,150 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Counts heap allocations made by the server between accepting a
+// connection and answering its request with the blocking model.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <simple_http.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+static std::atomic<size_t> g_allocations_count = 0;
+
+void* operator new(size_t size) {
+    g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+constexpr int kPort = 3001;
+
+constexpr size_t kWarmUpConnectionsCount = 1000;
+
+constexpr size_t kConnectionsCount = 20000;
+
+constexpr char kRequest[] =
+    "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+void HandleRequest(simple_http::IncomingMessage&,
+                   simple_http::OutgoingMessage& response) {
+    response.getHeaders().add(simple_http::HttpHeaderId::kContentLength, "2");
+    response.write("OK", 2);
+    response.end();
+}
+
+// Sends one request over a new connection and reads the response until the
+// server closes it.
+bool RunConnection() {
+    int descriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(kPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(descriptor, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    bool is_answered = false;
+    if (::send(descriptor, kRequest, sizeof(kRequest) - 1, 0) ==
+        sizeof(kRequest) - 1) {
+        char buffer[1024];
+        ssize_t received;
+        while ((received = ::recv(descriptor, buffer, sizeof(buffer), 0)) >
+               0) {
+            is_answered = true;
+        }
+    }
+
+    ::close(descriptor);
+    return is_answered;
+}
+
+int main() {
+    simple_http::HttpServer::Options options;
+    options.threads_count = 1;
+    options.connection_model =
+        simple_http::HttpServer::ConnectionModel::kBlocking;
+    simple_http::HttpServer::CreateError create_error;
+    auto server =
+        simple_http::HttpServer::create(options, HandleRequest, create_error);
+    if (create_error != simple_http::HttpServer::CreateError::kOk) {
+        std::cerr << "Create error: " << static_cast<int>(create_error)
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The server runs until the process exits.
+    std::thread([&server] { server->listen(kPort); }).detach();
+
+    size_t connected_count = 0;
+    for (size_t i = 0; i < kWarmUpConnectionsCount; i++) {
+        if (RunConnection()) {
+            connected_count++;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    if (connected_count == 0) {
+        std::cerr << "The server is not reachable at port " << kPort
+                  << std::endl;
+        std::quick_exit(EXIT_FAILURE);
+    }
+
+    size_t start_allocations_count = g_allocations_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kConnectionsCount; i++) {
+        if (!RunConnection()) {
+            std::cerr << "Connection " << i << " failed" << std::endl;
+            std::quick_exit(EXIT_FAILURE);
+        }
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    size_t allocations_count = g_allocations_count.load() -
+                               start_allocations_count;
+
+    double seconds = std::chrono::duration<double>(duration).count();
+    std::cout << "Connections: " << kConnectionsCount << std::endl;
+    std::cout << "Allocations per connection: "
+              << static_cast<double>(allocations_count) / kConnectionsCount
+              << std::endl;
+    std::cout << "Connections per second: " << kConnectionsCount / seconds
+              << std::endl;
+
+    std::quick_exit(allocations_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
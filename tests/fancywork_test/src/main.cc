@@ -6,6 +6,7 @@
 
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 
 const std::filesystem::path kStaticDir =
@@ -13,6 +14,18 @@ const std::filesystem::path kStaticDir =
 
 const std::filesystem::path kNotFoundPage = kStaticDir / "index.html";
 
+// Responses to repeated requests for the same path skip the file system.
+simple_http::StaticCache static_cache;
+
+// Files too large for the static cache are kept open.
+simple_http::OpenFileCache open_file_cache;
+
+// Request paths resolve without reaching the file system.
+simple_http::StaticIndex static_index(kStaticDir);
+
+// Read once at the start.
+std::shared_ptr<const simple_http::StaticCache::Entry> not_found_response;
+
 void HandleRequest(simple_http::IncomingMessage& request,
                    simple_http::OutgoingMessage& response);
 
@@ -27,6 +40,13 @@ int main() {
         return EXIT_FAILURE;
     }
 
+    not_found_response =
+        simple_http::RenderFileResponse("200", "OK", kNotFoundPage);
+    if (not_found_response == nullptr) {
+        std::cerr << "Not found page reading error" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     simple_http::HttpServer::CreateError create_error;
     auto server = simple_http::HttpServer::create(HandleRequest, create_error);
     if (create_error != simple_http::HttpServer::CreateError::kOk) {
@@ -50,12 +70,23 @@ int main() {
 
 void HandleRequest(simple_http::IncomingMessage& request,
                    simple_http::OutgoingMessage& response) {
-    auto file_path =
-        simple_http::GetRequestFilePath(request.getPath(), kStaticDir);
-    if (!file_path.has_value()) {
-        return simple_http::ResponseWithFile(response, "200", "OK",
-                                             kNotFoundPage);
+    auto accepted_codings = simple_http::ParseAcceptEncoding(
+        request.getHeaders()
+            .get(simple_http::HttpHeaderId::kAcceptEncoding)
+            .value_or(""));
+    auto match = static_index.find(request.getPath(), accepted_codings);
+    if (!match.has_value()) {
+        return simple_http::ResponseWithRendered(response,
+                                                 *not_found_response);
+    }
+
+    // Every variant of a file is cached under its own key.
+    if (simple_http::ResponseFromCache(response, static_cache, match->key) ||
+        simple_http::ResponseFromCache(response, open_file_cache,
+                                       match->key)) {
+        return;
     }
 
-    simple_http::ResponseWithFile(response, "200", "OK", file_path.value());
+    simple_http::ResponseWithFile(response, "200", "OK", match.value(),
+                                  static_cache, open_file_cache);
 }
@@ -0,0 +1,234 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Pipelines requests to the event loop model from clients that read their
+// responses slowly, stop reading or reset the connection, and checks that
+// the server keeps answering.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <simple_http.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+constexpr int kPort = 3010;
+
+constexpr size_t kBodyLength = 16384;
+
+constexpr size_t kRequestsCount = 64;
+
+constexpr size_t kStalledRequestsCount = 1024;
+
+const std::chrono::milliseconds kTimeout(300);
+
+constexpr char kRequest[] = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+void HandleRequest(simple_http::IncomingMessage&,
+                   simple_http::OutgoingMessage& response) {
+    std::string body(kBodyLength, 'x');
+    response.getHeaders().add("Content-Length", std::to_string(kBodyLength));
+    response.write(body);
+    response.end();
+}
+
+// Connects with a small receive buffer, so the server soon has to wait for
+// the client to read.
+int Connect() {
+    int descriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (descriptor < 0) {
+        return -1;
+    }
+
+    int receive_buffer_length = 4096;
+    ::setsockopt(descriptor, SOL_SOCKET, SO_RCVBUF, &receive_buffer_length,
+                 sizeof(receive_buffer_length));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(kPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(descriptor, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) != 0) {
+        ::close(descriptor);
+        return -1;
+    }
+
+    return descriptor;
+}
+
+// Closes the connection with a reset, so the server side does not linger
+// in TIME_WAIT and keep the port busy for the next run.
+void Reset(int descriptor) {
+    linger linger_option{1, 0};
+    ::setsockopt(descriptor, SOL_SOCKET, SO_LINGER, &linger_option,
+                 sizeof(linger_option));
+    ::close(descriptor);
+}
+
+bool SendRequests(int descriptor, size_t count) {
+    std::string requests;
+    for (size_t i = 0; i < count; i++) {
+        requests += kRequest;
+    }
+
+    std::string_view data(requests);
+    while (!data.empty()) {
+        ssize_t sent = ::send(descriptor, data.data(), data.length(), 0);
+        if (sent <= 0) {
+            return false;
+        }
+
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+
+    return true;
+}
+
+// Reads responses until the given number arrived or the server closed the
+// connection, pausing between reads. Returns the number of complete
+// responses.
+size_t ReceiveResponses(int descriptor, size_t count,
+                        std::chrono::milliseconds pause) {
+    std::string received;
+    size_t response_length = 0;
+    char buffer[4096];
+    while (response_length == 0 ||
+           received.length() < count * response_length) {
+        ssize_t length = ::recv(descriptor, buffer, sizeof(buffer), 0);
+        if (length <= 0) {
+            break;
+        }
+
+        received.append(buffer, static_cast<size_t>(length));
+        size_t head_end = received.find("\r\n\r\n");
+        if (response_length == 0 && head_end != std::string::npos) {
+            response_length = head_end + 4 + kBodyLength;
+        }
+
+        std::this_thread::sleep_for(pause);
+    }
+
+    if (response_length == 0 || !received.starts_with("HTTP/1.1 200 OK")) {
+        return 0;
+    }
+
+    return received.length() / response_length;
+}
+
+// Pipelined responses arrive in full while the client reads them in small
+// portions.
+bool CheckSlowReader() {
+    int descriptor = Connect();
+    if (descriptor < 0 || !SendRequests(descriptor, kRequestsCount)) {
+        return false;
+    }
+
+    size_t responses_count = ReceiveResponses(descriptor, kRequestsCount,
+                                              std::chrono::milliseconds(1));
+    ::close(descriptor);
+    if (responses_count != kRequestsCount) {
+        std::cerr << "Slow reader got " << responses_count << " responses of "
+                  << kRequestsCount << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// The client stops reading, so sending times out and the connection is
+// closed with responses still buffered.
+bool CheckStalledReader() {
+    int descriptor = Connect();
+    if (descriptor < 0) {
+        return false;
+    }
+
+    SendRequests(descriptor, kStalledRequestsCount);
+    std::this_thread::sleep_for(kTimeout * 3);
+    Reset(descriptor);
+    return true;
+}
+
+// The client resets the connection while responses are being sent.
+bool CheckReset() {
+    int descriptor = Connect();
+    if (descriptor < 0) {
+        return false;
+    }
+
+    SendRequests(descriptor, kRequestsCount);
+    char buffer[4096];
+    ::recv(descriptor, buffer, sizeof(buffer), 0);
+    Reset(descriptor);
+    return true;
+}
+
+bool CheckAnswered() {
+    int descriptor = Connect();
+    if (descriptor < 0 || !SendRequests(descriptor, 1)) {
+        return false;
+    }
+
+    size_t responses_count =
+        ReceiveResponses(descriptor, 1, std::chrono::milliseconds(0));
+    ::close(descriptor);
+    if (responses_count != 1) {
+        std::cerr << "Server is not answering" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main() {
+    simple_http::HttpServer::Options options;
+    options.threads_count = 2;
+    options.timeout = kTimeout;
+    options.keep_alive_max_requests = kStalledRequestsCount;
+    options.connection_model =
+        simple_http::HttpServer::ConnectionModel::kEventLoop;
+    simple_http::HttpServer::CreateError create_error;
+    auto server =
+        simple_http::HttpServer::create(options, HandleRequest, create_error);
+    if (create_error != simple_http::HttpServer::CreateError::kOk) {
+        std::cerr << "Create error: " << static_cast<int>(create_error)
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The server runs until the process exits.
+    std::thread([&server] {
+        simple_http::HttpServer::ListenError listen_error;
+        listen_error = server->listen(kPort);
+        std::cerr << "Listen error: " << static_cast<int>(listen_error)
+                  << std::endl;
+        std::quick_exit(EXIT_FAILURE);
+    }).detach();
+
+    int descriptor = -1;
+    for (size_t i = 0; i < 100 && descriptor < 0; i++) {
+        descriptor = Connect();
+        if (descriptor < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    ::close(descriptor);
+
+    bool is_passed = CheckAnswered();
+    is_passed = CheckSlowReader() && is_passed;
+    is_passed = CheckStalledReader() && CheckAnswered() && is_passed;
+    is_passed = CheckReset() && CheckAnswered() && is_passed;
+    is_passed = CheckSlowReader() && is_passed;
+
+    std::cout << (is_passed ? "Passed" : "Failed") << std::endl;
+    std::quick_exit(is_passed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
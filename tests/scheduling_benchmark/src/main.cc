@@ -0,0 +1,219 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Compares the latency of cheap requests mixed with expensive ones when the
+// thread pool uses one shared queue and when it steals work.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <simple_http.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+constexpr int kFirstPort = 3002;
+
+constexpr size_t kThreadsCount = 4;
+
+constexpr size_t kClientsCount = 16;
+
+constexpr size_t kRequestsPerClient = 400;
+
+// Every kSlowRequestPeriod-th request of a client is expensive.
+constexpr size_t kSlowRequestPeriod = 8;
+
+constexpr std::chrono::microseconds kSlowRequestCost(2000);
+
+constexpr char kFastRequest[] = "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+constexpr char kSlowRequest[] = "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+void HandleRequest(simple_http::IncomingMessage& request,
+                   simple_http::OutgoingMessage& response) {
+    if (request.getPath() == "/slow") {
+        auto end = std::chrono::steady_clock::now() + kSlowRequestCost;
+        while (std::chrono::steady_clock::now() < end) {
+        }
+    }
+
+    response.getHeaders().add(simple_http::HttpHeaderId::kContentLength, "2");
+    response.write("OK", 2);
+    response.end();
+}
+
+int Connect(int port) {
+    int descriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (descriptor < 0) {
+        return -1;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(descriptor, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) != 0) {
+        ::close(descriptor);
+        return -1;
+    }
+
+    return descriptor;
+}
+
+// Sends the request and reads the response with a two bytes long body.
+bool Exchange(int descriptor, std::string_view request) {
+    if (::send(descriptor, request.data(), request.length(), 0) !=
+        static_cast<ssize_t>(request.length())) {
+        return false;
+    }
+
+    std::string response;
+    char buffer[1024];
+    while (true) {
+        size_t head_end = response.find("\r\n\r\n");
+        if (head_end != std::string::npos &&
+            response.length() >= head_end + 4 + 2) {
+            return true;
+        }
+
+        ssize_t received = ::recv(descriptor, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return false;
+        }
+
+        response.append(buffer, received);
+    }
+}
+
+// Returns the latencies of the cheap requests in microseconds.
+bool RunClient(int port, size_t client_index, std::vector<double>& latencies) {
+    int descriptor = Connect(port);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kRequestsPerClient; i++) {
+        bool is_slow = (i + client_index) % kSlowRequestPeriod == 0;
+        auto start = std::chrono::steady_clock::now();
+        if (!Exchange(descriptor, is_slow ? kSlowRequest : kFastRequest)) {
+            ::close(descriptor);
+            return false;
+        }
+
+        if (!is_slow) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+        }
+    }
+
+    ::close(descriptor);
+    return true;
+}
+
+double GetPercentile(const std::vector<double>& sorted, double percentile) {
+    size_t index = static_cast<size_t>(percentile / 100 * (sorted.size() - 1));
+    return sorted[index];
+}
+
+bool RunScenario(const std::string& name,
+                 simple_http::HttpServer::Scheduling scheduling, int port) {
+    simple_http::HttpServer::Options options;
+    options.threads_count = kThreadsCount;
+    options.connection_model =
+        simple_http::HttpServer::ConnectionModel::kEventLoop;
+    options.scheduling = scheduling;
+    options.keep_alive_max_requests = kRequestsPerClient + 1;
+    options.keep_alive_timeout = std::chrono::seconds(60);
+    options.timeout = std::chrono::seconds(10);
+    simple_http::HttpServer::CreateError create_error;
+    auto server =
+        simple_http::HttpServer::create(options, HandleRequest, create_error);
+    if (create_error != simple_http::HttpServer::CreateError::kOk) {
+        std::cerr << "Create error: " << static_cast<int>(create_error)
+                  << std::endl;
+        return false;
+    }
+
+    // The server runs until the process exits.
+    simple_http::HttpServer* server_pointer = server.release();
+    std::thread([server_pointer, port] { server_pointer->listen(port); })
+        .detach();
+
+    bool is_ready = false;
+    for (size_t i = 0; i < 100 && !is_ready; i++) {
+        int descriptor = Connect(port);
+        if (descriptor >= 0) {
+            is_ready = Exchange(descriptor, kFastRequest);
+            ::close(descriptor);
+        }
+
+        if (!is_ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    if (!is_ready) {
+        std::cerr << "The server is not reachable at port " << port
+                  << std::endl;
+        return false;
+    }
+
+    std::vector<std::vector<double>> latencies(kClientsCount);
+    std::vector<char> results(kClientsCount, false);
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < kClientsCount; i++) {
+        clients.emplace_back([port, i, &latencies, &results] {
+            results[i] = RunClient(port, i, latencies[i]);
+        });
+    }
+
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    std::vector<double> all_latencies;
+    for (size_t i = 0; i < kClientsCount; i++) {
+        if (!results[i]) {
+            std::cerr << "Client " << i << " failed" << std::endl;
+            return false;
+        }
+
+        all_latencies.insert(all_latencies.end(), latencies[i].begin(),
+                             latencies[i].end());
+    }
+
+    std::sort(all_latencies.begin(), all_latencies.end());
+    std::cout << name << ": p50 " << GetPercentile(all_latencies, 50)
+              << " us, p99 " << GetPercentile(all_latencies, 99)
+              << " us, p99.9 " << GetPercentile(all_latencies, 99.9)
+              << " us, max " << all_latencies.back() << " us" << std::endl;
+    return true;
+}
+
+int main() {
+    std::cout << kThreadsCount << " workers, " << kClientsCount
+              << " clients, every " << kSlowRequestPeriod
+              << "th request takes " << kSlowRequestCost.count()
+              << " us, latency of the cheap requests:" << std::endl;
+
+    bool is_ok =
+        RunScenario("Shared queue",
+                    simple_http::HttpServer::Scheduling::kSharedQueue,
+                    kFirstPort) &&
+        RunScenario("Work stealing",
+                    simple_http::HttpServer::Scheduling::kWorkStealing,
+                    kFirstPort + 1);
+
+    std::quick_exit(is_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
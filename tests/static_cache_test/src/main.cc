@@ -0,0 +1,100 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Checks that a cached file response is kept while the file stays the same
+// and dropped once the file changes, so the next request reads it again.
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "../../../simple_http/lib/file.h"
+#include "../../../simple_http/lib/static_cache.h"
+
+using simple_http::File;
+using simple_http::StaticCache;
+
+constexpr std::string_view kKey = "/index.html";
+
+const std::chrono::milliseconds kValidTime(20);
+
+static bool Check(bool condition, const char* message) {
+    if (!condition) {
+        std::cerr << "Failed: " << message << std::endl;
+    }
+
+    return condition;
+}
+
+static void WriteFile(const std::filesystem::path& path,
+                      const std::string& content) {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream << content;
+}
+
+// Caches the file the way ResponseWithFile() does.
+static bool Cache(StaticCache& cache, const std::filesystem::path& path) {
+    File::OpenError error;
+    auto entry = std::make_shared<StaticCache::Entry>();
+    entry->status = File::readStatus(path, error);
+    if (!Check(error == File::OpenError::kOk, "the file has no status")) {
+        return false;
+    }
+
+    std::ifstream stream(path, std::ios::binary);
+    entry->body.assign(std::istreambuf_iterator<char>(stream),
+                       std::istreambuf_iterator<char>());
+    entry->path = path;
+    return Check(cache.insert(kKey, entry), "the entry is not inserted");
+}
+
+static bool CheckBody(StaticCache& cache, const std::string& body) {
+    std::shared_ptr<const StaticCache::Entry> entry = cache.find(kKey);
+    return entry != nullptr && entry->body == body;
+}
+
+int main() {
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "static_cache_test.html";
+    WriteFile(path, "first");
+
+    simple_http::StaticCacheOptions options;
+    options.valid_time = kValidTime;
+    StaticCache cache(options);
+    bool is_ok = Cache(cache, path);
+    is_ok &= Check(CheckBody(cache, "first"), "the file is not cached");
+
+    // An unchanged file is kept after the check.
+    std::this_thread::sleep_for(kValidTime * 2);
+    is_ok &= Check(CheckBody(cache, "first"), "an unchanged file is dropped");
+
+    // Within the valid time a change is not noticed yet.
+    WriteFile(path, "second version");
+    is_ok &= Check(CheckBody(cache, "first"), "the entry is checked early");
+
+    std::this_thread::sleep_for(kValidTime * 2);
+    is_ok &= Check(cache.find(kKey) == nullptr, "a changed file is served");
+    is_ok &= Cache(cache, path);
+    is_ok &= Check(CheckBody(cache, "second version"),
+                   "the changed file is not cached again");
+
+    // A deleted file is dropped too.
+    std::filesystem::remove(path);
+    std::this_thread::sleep_for(kValidTime * 2);
+    is_ok &= Check(cache.find(kKey) == nullptr, "a deleted file is served");
+
+    if (!is_ok) {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Static cache checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
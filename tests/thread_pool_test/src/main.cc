@@ -0,0 +1,109 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Checks that a thread pool stops, idle or with tasks still queued, and
+// that the queued tasks are called as expired to release what they hold.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "../../../simple_http/lib/thread_pool.h"
+
+struct ThreadState {};
+
+typedef simple_http::ThreadPool<ThreadState> Pool;
+
+constexpr size_t kTasksCount = 200;
+
+static bool Check(bool condition, const char* message) {
+    if (!condition) {
+        std::cerr << "Failed: " << message << std::endl;
+    }
+
+    return condition;
+}
+
+static std::unique_ptr<Pool> CreatePool(size_t threads_count) {
+    return Pool::create(threads_count,
+                        [](size_t) { return std::make_unique<ThreadState>(); });
+}
+
+static bool CheckIdleStop() {
+    std::unique_ptr<Pool> pool = CreatePool(2);
+    if (!Check(pool != nullptr, "the pool is not created")) {
+        return false;
+    }
+
+    // Lets the workers go to sleep.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pool.reset();
+    return true;
+}
+
+static bool CheckQueuedStop() {
+    std::unique_ptr<Pool> pool = CreatePool(1);
+    if (!Check(pool != nullptr, "the pool is not created")) {
+        return false;
+    }
+
+    std::atomic<bool> is_started = false;
+    std::atomic<size_t> ran_count = 0;
+    std::atomic<size_t> released_count = 0;
+    pool->post([&](ThreadState*, bool) {
+        is_started.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ran_count.fetch_add(1);
+    });
+    while (!is_started.load()) {
+        std::this_thread::yield();
+    }
+
+    // Stands for a resource held by a queued task, e.g. a socket.
+    auto resource = std::make_shared<int>(0);
+    for (size_t i = 0; i < kTasksCount; i++) {
+        pool->post([&ran_count, &released_count, resource](
+                       ThreadState*, bool is_expired) {
+            if (is_expired) {
+                released_count.fetch_add(1);
+            } else {
+                ran_count.fetch_add(1);
+            }
+        });
+    }
+
+    pool.reset();
+    bool is_ok = Check(ran_count.load() >= 1, "the running task is lost");
+    is_ok &= Check(ran_count.load() + released_count.load() ==
+                       kTasksCount + 1,
+                   "queued tasks are not called");
+    is_ok &= Check(released_count.load() > 0,
+                   "queued tasks are not called as expired");
+    is_ok &= Check(resource.use_count() == 1,
+                   "queued tasks are not released");
+    return is_ok;
+}
+
+int main() {
+    // A pool that does not stop hangs the check.
+    std::thread([] {
+        std::this_thread::sleep_for(std::chrono::seconds(10));
+        std::cerr << "Failed: the pool does not stop" << std::endl;
+        std::quick_exit(EXIT_FAILURE);
+    }).detach();
+
+    bool is_ok = true;
+    is_ok &= CheckIdleStop();
+    is_ok &= CheckQueuedStop();
+
+    if (!is_ok) {
+        std::quick_exit(EXIT_FAILURE);
+    }
+
+    std::cout << "Thread pool checks passed" << std::endl;
+    std::quick_exit(EXIT_SUCCESS);
+}
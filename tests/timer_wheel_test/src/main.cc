@@ -0,0 +1,81 @@
+// Copyright 2024 Dmitrii Balakin. All rights reserved.
+// Use of this source code is governed by a MIT License that can be
+// found in the LICENSE file.
+
+// Checks that timers expire on time, also when their deadline crosses a
+// round of the top level of the wheel.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "../../../simple_http/lib/timer_wheel.h"
+
+using simple_http::TimerWheel;
+
+constexpr uint64_t kTopRoundTicks = uint64_t{1} << 24;
+
+static bool Check(bool condition, const char* message) {
+    if (!condition) {
+        std::cerr << "Failed: " << message << std::endl;
+    }
+
+    return condition;
+}
+
+// Schedules a timer delay_ms after start_ms and checks that it expires at
+// its deadline, not earlier and not later.
+static bool CheckExpiry(uint64_t start_ms, uint64_t delay_ms) {
+    TimerWheel::Clock::time_point origin = TimerWheel::Clock::now();
+    TimerWheel wheel(origin);
+    TimerWheel::Timer timer;
+
+    TimerWheel::Clock::time_point start =
+        origin + std::chrono::milliseconds(start_ms);
+    TimerWheel::Clock::time_point deadline =
+        start + std::chrono::milliseconds(delay_ms);
+    wheel.advance(start);
+    wheel.schedule(&timer, deadline);
+
+    bool is_ok = Check(wheel.getNextDeadline() > start,
+                       "the next deadline is in the past");
+    is_ok &= Check(wheel.getNextDeadline() <= deadline,
+                   "the next deadline is after the timer deadline");
+
+    // Follows the deadlines the way an event loop does.
+    TimerWheel::Clock::time_point now = start;
+    while (wheel.takeExpired() == nullptr) {
+        TimerWheel::Clock::time_point next = wheel.getNextDeadline();
+        if (!Check(next > now && next <= deadline,
+                   "the next deadline does not move towards the timer")) {
+            return false;
+        }
+
+        now = next;
+        wheel.advance(now);
+    }
+
+    is_ok &= Check(now == deadline, "the timer expired at a wrong time");
+    is_ok &= Check(!timer.isScheduled(), "the expired timer is scheduled");
+    return is_ok;
+}
+
+int main() {
+    bool is_ok = true;
+    is_ok &= CheckExpiry(0, 5);
+    is_ok &= CheckExpiry(0, 5000);
+    is_ok &= CheckExpiry(1000, kTopRoundTicks - 1);
+    // The deadline is in the next round while the wheel is in the last top
+    // level slot.
+    is_ok &= CheckExpiry(kTopRoundTicks - 10, 5000);
+    is_ok &= CheckExpiry(kTopRoundTicks - 10, kTopRoundTicks - 1);
+    is_ok &= CheckExpiry(3 * kTopRoundTicks - 300000, 600000);
+
+    if (!is_ok) {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Timer wheel checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}